@@ -0,0 +1,38 @@
+// c_types.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's c_types.h, so that the mesh-modules
+// can be compiled and benchmarked on a Linux-host.
+
+#ifndef __C_TYPES_H__
+#define __C_TYPES_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t uint8;
+typedef int8_t sint8;
+typedef uint16_t uint16;
+typedef int16_t sint16;
+typedef uint32_t uint32;
+typedef int32_t sint32;
+
+typedef unsigned char bool;
+#define BOOL bool
+#define true (1)
+#define false (0)
+#define TRUE true
+#define FALSE false
+
+#define __packed __attribute__((packed))
+#define LOCAL static
+
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RODATA_ATTR
+
+#define BIT(nr) (1UL << (nr))
+
+#endif
@@ -0,0 +1,39 @@
+// espconn.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's espconn.h.
+
+#ifndef __ESPCONN_H__
+#define __ESPCONN_H__
+
+#include "c_types.h"
+
+#define ESPCONN_OK 0            // No error
+#define ESPCONN_MEM -1          // Out of memory
+#define ESPCONN_TIMEOUT -3      // Timeout
+#define ESPCONN_RTE -4          // Routing problem
+#define ESPCONN_INPROGRESS -5   // Operation in progress
+#define ESPCONN_MAXNUM -7       // Total number exceeds the maximum limitation
+#define ESPCONN_ARG -12         // Illegal argument
+#define ESPCONN_IF -14          // Low-level error
+
+typedef struct _esp_tcp {
+    int remote_port;
+    int local_port;
+    uint8 local_ip[4];
+    uint8 remote_ip[4];
+} esp_tcp;
+
+struct espconn {
+    int type;
+    int state;
+    union {
+        esp_tcp *tcp;
+    } proto;
+    void *reverse;
+};
+
+#endif
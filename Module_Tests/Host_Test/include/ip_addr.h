@@ -0,0 +1,18 @@
+// ip_addr.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of lwIP's ip_addr.h.
+
+#ifndef __IP_ADDR_H__
+#define __IP_ADDR_H__
+
+#include "c_types.h"
+
+struct ip_addr {
+    uint32 addr;
+};
+
+#endif
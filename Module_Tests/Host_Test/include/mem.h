@@ -0,0 +1,19 @@
+// mem.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's mem.h; every allocation is counted by
+// the shim (cf. sdk_shim.c).
+
+#ifndef __MEM_H__
+#define __MEM_H__
+
+#include "c_types.h"
+
+void *os_zalloc(size_t size);
+void *os_malloc(size_t size);
+void os_free(void *ptr);
+
+#endif
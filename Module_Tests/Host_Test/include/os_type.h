@@ -0,0 +1,35 @@
+// os_type.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's os_type.h (timer- and task-
+// types).
+
+#ifndef __OS_TYPE_H__
+#define __OS_TYPE_H__
+
+#include "c_types.h"
+
+typedef void os_timer_func_t(void *arg);
+
+typedef struct _os_timer_t {
+    struct _os_timer_t *timer_next;
+    uint32 timer_expire;
+    uint32 timer_period;
+    os_timer_func_t *timer_func;
+    void *timer_arg;
+} os_timer_t;
+
+typedef uint32 os_signal_t;
+typedef uint32 os_param_t;
+
+typedef struct {
+    os_signal_t sig;
+    os_param_t par;
+} os_event_t;
+
+typedef void (*os_task_t)(os_event_t *e);
+
+#endif
@@ -0,0 +1,34 @@
+// osapi.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's osapi.h.
+
+#ifndef __OSAPI_H__
+#define __OSAPI_H__
+
+#include <string.h>
+#include <stdio.h>
+#include "os_type.h"
+
+#define os_memcmp memcmp
+#define os_memcpy memcpy
+#define os_memmove memmove
+#define os_memset memset
+#define os_strlen strlen
+#define os_sprintf sprintf
+
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(ipaddr) ((uint8_t *) (ipaddr))[0], ((uint8_t *) (ipaddr))[1], ((uint8_t *) (ipaddr))[2], ((uint8_t *) (ipaddr))[3]
+
+int os_printf(const char *format, ...);
+
+void os_timer_disarm(os_timer_t *timer);
+void os_timer_setfn(os_timer_t *timer, os_timer_func_t *func, void *arg);
+void os_timer_arm(os_timer_t *timer, uint32 time, bool repeat);
+
+#endif
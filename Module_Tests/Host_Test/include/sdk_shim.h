@@ -0,0 +1,52 @@
+// sdk_shim.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Control-interface of the host-side SDK-shim (cf. sdk_shim.c).
+
+#ifndef __SDK_SHIM_H__
+#define __SDK_SHIM_H__
+
+#include "c_types.h"
+#include "mesh.h"
+
+/*------------- defines --------------*/
+
+#define SDK_SHIM_FLASH_SECTORS 8  // Size of the simulated flash; user_rf_cal_sector_set returns the fifth-last sector
+
+/*--------- global variables ---------*/
+
+extern uint32 sdk_shim_alloc_count;  // Number of calls of os_zalloc/os_malloc
+extern uint32 sdk_shim_free_count;   // Number of calls of os_free
+extern uint32 sdk_shim_time;         // Value returned by system_get_time (in us)
+extern bool sdk_shim_verbose;        // Pass os_printf on to stdout
+extern uint32 sdk_shim_printf_count; // Number of calls of os_printf (whether verbose or not)
+
+extern uint8 sdk_shim_flash[];       // Content of the simulated flash
+extern uint32 sdk_shim_flash_erase_count;  // Number of calls of spi_flash_erase_sector
+extern sint32 sdk_shim_flash_write_limit;  // Number of bytes, that can still be written before the simulated power-loss (-1 = unlimited)
+
+extern uint32 sdk_shim_task_posts;  // Number of pending events of all tasks (cf. sdk_shim_task_run)
+
+extern bool sdk_shim_mesh_root;      // Value returned by espconn_mesh_is_root
+extern uint8 sdk_shim_mesh_status;   // Value returned by espconn_mesh_get_status
+extern uint8 sdk_shim_mesh_parent[ESP_MESH_ADDR_LEN]; // softAP-MAC-address of the parent-node returned by espconn_mesh_get_node_info
+extern bool sdk_shim_mesh_parent_known;  // The simulated node has a parent-node
+extern uint8 *sdk_shim_mesh_nodes;   // MAC-addresses returned by espconn_mesh_get_node_info for MESH_NODE_ALL (the router's first; NULL = none)
+extern uint16 sdk_shim_mesh_node_count; // Number of MAC-addresses of sdk_shim_mesh_nodes
+extern uint32 sdk_shim_mesh_sent_count;  // Number of packets sent by espconn_mesh_sent
+extern sint8 sdk_shim_mesh_sent_result;  // Value returned by espconn_mesh_sent (any other than ESPCONN_OK simulates a failure)
+extern struct mesh_header_format sdk_shim_mesh_sent_header;  // Mesh-header of the last sent packet
+extern void (*sdk_shim_mesh_sent_handler)(uint8 *pdata, uint16 len); // Called with every sent packet (optional)
+extern uint32 sdk_shim_mesh_release_count; // Number of calls of espconn_mesh_release_congest
+
+/*------------ functions -------------*/
+
+uint64_t sdk_shim_clock_ns(void);
+void sdk_shim_flash_reset(void);
+uint32 sdk_shim_task_run(void);
+uint32 sdk_shim_timers_run(void);
+
+#endif
@@ -0,0 +1,27 @@
+// spi_flash.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's spi_flash.h; the flash is
+// simulated in RAM by the SDK-shim (cf. sdk_shim.c).
+
+#ifndef __SPI_FLASH_H__
+#define __SPI_FLASH_H__
+
+#include "c_types.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+    SPI_FLASH_RESULT_OK,
+    SPI_FLASH_RESULT_ERR,
+    SPI_FLASH_RESULT_TIMEOUT
+} SpiFlashOpResult;
+
+SpiFlashOpResult spi_flash_erase_sector(uint16 sec);
+SpiFlashOpResult spi_flash_write(uint32 des_addr, uint32 *src_addr, uint32 size);
+SpiFlashOpResult spi_flash_read(uint32 src_addr, uint32 *des_addr, uint32 size);
+
+#endif
@@ -0,0 +1,21 @@
+// user_config.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Configuration of the host-tests; includes the project's configuration
+// and only overrides what the tests need differently.
+
+#ifndef __HOST_TEST_USER_CONFIG_H__
+#define __HOST_TEST_USER_CONFIG_H__
+
+#include "../../../include/user_config.h"
+
+// The benchmarks register up to 1024 nodes, so the node-pool has to be sized
+// for more mesh-layers than on the device:
+// capacity = (4^6-1)/3 = 1365 nodes
+#undef MAX_HOPS
+#define MAX_HOPS 6
+
+#endif
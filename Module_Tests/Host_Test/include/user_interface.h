@@ -0,0 +1,55 @@
+// user_interface.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side replacement of the SDK's user_interface.h; only the functions
+// used by the mesh-modules are provided.
+
+#ifndef __USER_INTERFACE_H__
+#define __USER_INTERFACE_H__
+
+#include "os_type.h"
+#include "ip_addr.h"
+
+#define NULL_MODE 0x00
+#define STATION_MODE 0x01
+#define SOFTAP_MODE 0x02
+#define STATIONAP_MODE 0x03
+
+#define STATION_IF 0x00
+#define SOFTAP_IF 0x01
+
+enum {
+    USER_TASK_PRIO_0 = 0,
+    USER_TASK_PRIO_1,
+    USER_TASK_PRIO_2,
+    USER_TASK_PRIO_MAX
+};
+
+typedef enum _auth_mode {
+    AUTH_OPEN = 0,
+    AUTH_WEP,
+    AUTH_WPA_PSK,
+    AUTH_WPA2_PSK,
+    AUTH_WPA_WPA2_PSK,
+    AUTH_MAX
+} AUTH_MODE;
+
+struct station_config {
+    uint8 ssid[32];
+    uint8 password[64];
+    uint8 bssid_set;
+    uint8 bssid[6];
+};
+
+uint32 system_get_time(void);
+uint32 system_get_free_heap_size(void);
+bool system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen);
+bool system_os_post(uint8 prio, os_signal_t sig, os_param_t par);
+
+uint8 wifi_get_opmode(void);
+bool wifi_get_macaddr(uint8 if_index, uint8 *macaddr);
+
+#endif
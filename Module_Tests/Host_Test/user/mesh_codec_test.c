@@ -0,0 +1,100 @@
+// mesh_codec_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the portable implementation of the packet-
+// format of the mesh (cf. mesh_codec.h). Covers building a packet with options
+// and user-data, reading it back as well as the rejection of truncated or
+// inconsistent packets.
+
+#include <stdlib.h>
+#include "osapi.h"
+#include "mesh.h"
+#include "mesh_codec.h"
+
+#define TEST_BUF_SIZE 128
+
+static uint8_t test_dst[ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x00, 0x01};
+static uint8_t test_src[ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x00, 0x02};
+static uint8_t test_macs[2*ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x00, 0x03, 0x18, 0xfe, 0x34, 0x00, 0x00, 0x04};
+static uint8_t test_usr_option[2] = {0x01, 0x02};
+static uint8_t test_usr_data[4] = {'d', 'a', 't', 'a'};
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+// Build the test-packet: two options and the user-data
+static bool test_build(uint8_t *buf, uint16_t size) {
+  struct mesh_header_format *header = (struct mesh_header_format *) buf;
+
+  return mesh_codec_packet_init(buf, size, test_dst, test_src, true, true, true, M_PROTO_BIN, true)
+         && mesh_codec_option_append(header, size, M_O_TOPO_RESP, test_macs, sizeof(test_macs))
+         && mesh_codec_option_append(header, size, M_O_USR_OPTION, test_usr_option, sizeof(test_usr_option))
+         && mesh_codec_usr_data_set(header, size, test_usr_data, sizeof(test_usr_data));
+}
+
+// Read all options of the given packet; return their number or -1, if the
+// option-list is malformed
+static int16_t test_options_count(struct mesh_header_format *header) {
+  uint16_t offset = 0;
+  int16_t count = 0;
+
+  while (mesh_codec_option_next(header, &offset)) {
+    count++;
+  }
+  return mesh_codec_options_end(header, offset) ? count : -1;
+}
+
+int main(void) {
+  uint8_t buf[TEST_BUF_SIZE];
+  uint8_t *usr_data = NULL;
+  uint16_t usr_data_len = 0, len = 0;
+  struct mesh_header_format *header = (struct mesh_header_format *) buf;
+  struct mesh_header_option_format *option = NULL;
+
+  // Build the packet and read it back
+  test_check(test_build(buf, sizeof(buf)), "packet is built");
+  len = header->len;
+  test_check(len == ESP_MESH_HLEN+ESP_MESH_OT_LEN_LEN+2*ESP_MESH_OPTION_HLEN+sizeof(test_macs)+sizeof(test_usr_option)+sizeof(test_usr_data), "packet has the expected length");
+  test_check(mesh_codec_header_check(header, len), "packet passes the check");
+  test_check(mesh_codec_proto_get(header) == M_PROTO_BIN && header->proto.p2p && header->proto.d && header->cr && header->oe, "header-fields are set");
+  test_check(!memcmp(header->dst_addr, test_dst, ESP_MESH_ADDR_LEN) && !memcmp(header->src_addr, test_src, ESP_MESH_ADDR_LEN), "addresses are set");
+  test_check(test_options_count(header) == 2, "both options are read");
+  option = mesh_codec_option_find(header, M_O_USR_OPTION, 1);
+  test_check(option && option->olen == sizeof(test_usr_option) && !memcmp(option->ovalue, test_usr_option, sizeof(test_usr_option)), "option is found by its type");
+  test_check(!mesh_codec_option_find(header, M_O_TOPO_RESP, 2), "missing option isn't found");
+  test_check(mesh_codec_usr_data_get(header, &usr_data, &usr_data_len) && usr_data_len == sizeof(test_usr_data) && !memcmp(usr_data, test_usr_data, sizeof(test_usr_data)), "user-data follows the options");
+
+  // The builder respects the order and the size of the buffer
+  test_check(!mesh_codec_option_append(header, sizeof(buf), M_O_USR_OPTION, test_usr_option, sizeof(test_usr_option)), "no option after the user-data");
+  test_check(!test_build(buf, len-1), "packet exceeding the buffer isn't built");
+
+  // Truncated and inconsistent packets are rejected
+  test_build(buf, sizeof(buf));
+  test_check(!mesh_codec_header_check(header, len-1), "truncated packet fails the check");
+  test_check(!mesh_codec_header_check(header, ESP_MESH_HLEN-1), "truncated header fails the check");
+  header->option[0].ot_len = len;
+  test_check(!mesh_codec_header_check(header, len), "option-list exceeding the packet fails the check");
+  header->option[0].ot_len = ESP_MESH_OT_LEN_LEN+ESP_MESH_OPTION_HLEN+sizeof(test_macs)-1;
+  test_check(mesh_codec_header_check(header, len) && test_options_count(header) == -1, "option exceeding the option-list is detected");
+
+  // Packet without options
+  test_check(mesh_codec_packet_init(buf, sizeof(buf), test_dst, test_src, false, false, false, M_PROTO_NONE, false), "packet without options is built");
+  test_check(mesh_codec_header_check(header, header->len) && !header->proto.d && !header->cr && test_options_count(header) == 0 && !mesh_codec_usr_data_get(header, &usr_data, &usr_data_len), "it flows downwards without options and user-data");
+
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+// mesh_device_bench.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side benchmark of the registry of mesh-nodes (cf.
+// mesh_device.c). For each mesh-size, the duration per operation (add, search,
+// update_timestamp, del and the reconciliation with a full topology-snapshot,
+// per node of the snapshot) as well as the number of heap-allocations during
+// the operation are measured. The numbers are those of the host, of course,
+// but they show how the registry scales and allow to catch regressions in its
+// hot path.
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "mesh_device.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define BENCH_OPS_MIN 200000  // Minimum number of operations per measurement, to get stable results
+
+static const uint16_t bench_sizes[] = {8, 64, 256, 1024};
+
+static struct mesh_device_mac_type *bench_nodes = NULL;
+static struct mesh_device_mac_type *bench_snapshot = NULL;
+static struct mesh_device_mac_type bench_root = {{0x18, 0xfe, 0x34, 0xff, 0xff, 0xff}};
+
+// Derive a reproducible MAC-address with the Espressif-OUI from the given index
+static void bench_mac(uint32_t idx, struct mesh_device_mac_type *node) {
+  uint32_t nic = idx*2654435761u;
+
+  node->mac[0] = 0x18;
+  node->mac[1] = 0xfe;
+  node->mac[2] = 0x34;
+  node->mac[3] = (nic >> 16) & 0xFF;
+  node->mac[4] = (nic >> 8) & 0xFF;
+  node->mac[5] = nic & 0xFF;
+}
+
+// Set up a registry containing the root and the first count benchmark-nodes
+static void bench_setup(uint16_t count) {
+  mesh_device_list_init();
+  mesh_device_root_set(&bench_root);
+  mesh_device_add(bench_nodes, count);
+}
+
+// Print a result-line
+static void bench_report(uint16_t count, const char *operation, uint64_t ns, uint32_t ops, uint32_t allocs) {
+  printf("%6d  %-18s %10.1f %10u\n", count, operation, (double) ns/ops, allocs);
+}
+
+static void bench_run(uint16_t count) {
+  uint32_t reps = (BENCH_OPS_MIN+count-1)/count, rep = 0, allocs = 0;
+  uint16_t idx = 0;
+  uint64_t start = 0, ns = 0;
+  volatile uint32_t hits = 0;
+  struct mesh_device_sync_type result;
+
+  // add: fill an empty registry node by node
+  ns = 0;
+  allocs = 0;
+  for (rep = 0; rep < reps; rep++) {
+    bench_setup(0);
+    allocs -= sdk_shim_alloc_count;
+    start = sdk_shim_clock_ns();
+    for (idx = 0; idx < count; idx++) {
+      mesh_device_add(&bench_nodes[idx], 1);
+    }
+    ns += sdk_shim_clock_ns()-start;
+    allocs += sdk_shim_alloc_count;
+    mesh_device_list_release();
+  }
+  bench_report(count, "add", ns, reps*count, allocs);
+
+  bench_setup(count);
+
+  // search: half hits, half misses
+  allocs = sdk_shim_alloc_count;
+  start = sdk_shim_clock_ns();
+  for (rep = 0; rep < reps; rep++) {
+    for (idx = 0; idx < count; idx++) {
+      hits += mesh_device_list_search(&bench_nodes[(idx & 1) ? idx : count+idx]);
+    }
+  }
+  bench_report(count, "search", sdk_shim_clock_ns()-start, reps*count, sdk_shim_alloc_count-allocs);
+
+  // update_timestamp
+  allocs = sdk_shim_alloc_count;
+  start = sdk_shim_clock_ns();
+  for (rep = 0; rep < reps; rep++) {
+    sdk_shim_time += 1000;
+    for (idx = 0; idx < count; idx++) {
+      mesh_device_update_timestamp(&bench_nodes[idx], 1);
+    }
+  }
+  bench_report(count, "update_timestamp", sdk_shim_clock_ns()-start, reps*count, sdk_shim_alloc_count-allocs);
+
+  // sync: reconcile with a full topology-snapshot every topology-interval; the
+  // snapshot is a window of count nodes sliding over a ring of 2*count
+  // benchmark-nodes, so every round the same share of the nodes (1/16) joins
+  // the mesh and leaves it (and expires later on), independent of the mesh-
+  // size; the nodes, that left, stay registered for up to three rounds (cf.
+  // SUB_NODE_TIMEOUT_THRESHOLD), which still fits into the node-pool; the
+  // duration is reported per node of the snapshot, so it stays flat as long as
+  // the reconciliation is linear (on the host, it rises by ~20 % at 1024 nodes,
+  // since the node-pool and the hash-index no longer fit into the L1-cache; the
+  // probe-sequences of the hash-index stay short at any size, since it is at
+  // most ~30 % full)
+  allocs = sdk_shim_alloc_count;
+  ns = 0;
+  reps = (BENCH_OPS_MIN+count-1)/count;
+  for (rep = 0; rep < reps; rep++) {
+    sdk_shim_time += TOPOLOGY_TIME_INTERVAL*1000;
+    for (idx = 0; idx < count; idx++) {
+      bench_snapshot[idx] = bench_nodes[(rep*(count/16+1)+idx)%(2*count)];
+    }
+    start = sdk_shim_clock_ns();
+    mesh_device_sync(&bench_root, bench_snapshot, count, &result);
+    ns += sdk_shim_clock_ns()-start;
+  }
+  bench_report(count, "sync (per node)", ns, reps*count, sdk_shim_alloc_count-allocs);
+  mesh_device_list_release();
+
+  // del: empty a full registry node by node
+  ns = 0;
+  allocs = 0;
+  for (rep = 0; rep < reps; rep++) {
+    bench_setup(count);
+    allocs -= sdk_shim_alloc_count;
+    start = sdk_shim_clock_ns();
+    for (idx = 0; idx < count; idx++) {
+      mesh_device_del(&bench_nodes[idx], 1);
+    }
+    ns += sdk_shim_clock_ns()-start;
+    allocs += sdk_shim_alloc_count;
+    mesh_device_list_release();
+  }
+  bench_report(count, "del", ns, reps*count, allocs);
+
+  (void) hits;
+}
+
+int main(void) {
+  struct mesh_device_stats_type stats;
+  uint32_t idx = 0;
+  uint8_t size_idx = 0;
+
+  bench_nodes = (struct mesh_device_mac_type *) malloc(2*1024*sizeof(struct mesh_device_mac_type));
+  bench_snapshot = (struct mesh_device_mac_type *) malloc(1024*sizeof(struct mesh_device_mac_type));
+  if (!bench_nodes || !bench_snapshot) {
+    return 1;
+  }
+  for (idx = 0; idx < 2*1024; idx++) {
+    bench_mac(idx, &bench_nodes[idx]);
+  }
+
+  mesh_device_list_init();
+  mesh_device_stats_get(&stats);
+  mesh_device_list_release();
+  printf("mesh_device benchmark (node-pool capacity: %d nodes)\n\n", stats.capacity);
+  printf("%6s  %-18s %10s %10s\n", "nodes", "operation", "ns/op", "allocs");
+
+  for (size_idx = 0; size_idx < sizeof(bench_sizes)/sizeof(bench_sizes[0]); size_idx++) {
+    bench_run(bench_sizes[size_idx]);
+  }
+
+  free(bench_snapshot);
+  free(bench_nodes);
+  return 0;
+}
@@ -0,0 +1,143 @@
+// mesh_device_flash_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the persistence of the registry of mesh-nodes
+// (cf. mesh_device_flash.c) against the simulated flash of the SDK-shim. Covers
+// the restoration after a restart (incl. the version of the list and the ages
+// of the nodes relative to the last confirmation of the root), the rate-
+// limiting and skipping of unchanged snapshots, the alternation of the two
+// sectors as well as the fallback to the older snapshot after a power-loss
+// during a write or a corrupted sector.
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "spi_flash.h"
+#include "mesh_device.h"
+#include "mesh_device_flash.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define TEST_NODES 40
+
+uint32 user_rf_cal_sector_set(void); // Cf. sdk_shim.c
+
+static struct mesh_device_mac_type test_nodes[TEST_NODES];
+static struct mesh_device_mac_type test_root = {{0x18, 0xfe, 0x34, 0xff, 0xff, 0xff}};
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+// Derive a reproducible MAC-address with the Espressif-OUI from the given index
+static void test_mac(uint32_t idx, struct mesh_device_mac_type *node) {
+  node->mac[0] = 0x18;
+  node->mac[1] = 0xfe;
+  node->mac[2] = 0x34;
+  node->mac[3] = 0x00;
+  node->mac[4] = (idx >> 8) & 0xFF;
+  node->mac[5] = idx & 0xFF;
+}
+
+// Check, that exactly the first count test-nodes are registered
+static bool test_registered(uint16_t count) {
+  uint16_t idx = 0;
+
+  for (idx = 0; idx < TEST_NODES; idx++) {
+    if (mesh_device_list_search(&test_nodes[idx]) != (idx < count)) {
+      return false;
+    }
+  }
+  return mesh_device_list_count() == count;
+}
+
+// Simulate a restart: the registry is released and restored from flash
+static bool test_restart(void) {
+  mesh_device_list_release();
+  return mesh_device_flash_load();
+}
+
+int main(void) {
+  uint16_t idx = 0;
+  uint32_t erase_count = 0, version = 0;
+  struct mesh_device_flash_header_type *first = NULL, *second = NULL;
+
+  for (idx = 0; idx < TEST_NODES; idx++) {
+    test_mac(idx, &test_nodes[idx]);
+  }
+  sdk_shim_flash_reset();
+  sdk_shim_time = 1000000;
+
+  test_check(!mesh_device_flash_load(), "load from empty flash fails");
+
+  // Register the first half of the nodes now and the second half 10 s later,
+  // when the root confirms the list; the ages are measured against this
+  // confirmation, so a snapshot written long after it (e.g. between two
+  // topology-tests far apart) still restores all nodes
+  mesh_device_root_set(&test_root);
+  mesh_device_add(test_nodes, TEST_NODES/2);
+  sdk_shim_time += 10000000;
+  mesh_device_add(&test_nodes[TEST_NODES/2], TEST_NODES/2);
+  mesh_device_update_timestamp(&test_root, 1);
+  sdk_shim_time += 8*SUB_NODE_TIMEOUT_THRESHOLD*1000;
+
+  test_check(mesh_device_flash_save(false), "first snapshot is written");
+  test_check(sdk_shim_flash_erase_count == 1, "first snapshot erases one sector");
+  version = mesh_device_list_version();
+  test_check(test_restart() && test_registered(TEST_NODES), "restart restores all nodes");
+  test_check(mesh_device_list_version() == version, "restored list has the same version");
+  mesh_device_del(&test_nodes[TEST_NODES-1], 1);
+  test_check(mesh_device_list_version() != version, "deleting a node changes the version");
+  mesh_device_add(&test_nodes[TEST_NODES-1], 1);
+  test_check(mesh_device_list_version() == version, "adding it again restores the version");
+
+  erase_count = sdk_shim_flash_erase_count;
+  test_check(mesh_device_flash_save(true) && sdk_shim_flash_erase_count == erase_count, "unchanged list isn't written again");
+
+  // The restored nodes keep their age: the first half expires 10 s earlier
+  sdk_shim_time += (SUB_NODE_TIMEOUT_THRESHOLD-5000)*1000;
+  test_check(mesh_device_expire() == TEST_NODES/2, "restored nodes expire according to their age");
+  test_check(mesh_device_list_search(&test_nodes[TEST_NODES-1]), "younger restored nodes are kept");
+
+  // Changes are only written after MESH_DEVICE_FLASH_SAVE_INTERVAL
+  mesh_device_add(test_nodes, TEST_NODES/2);
+  test_check(mesh_device_flash_save(false) && sdk_shim_flash_erase_count == erase_count, "changes are rate-limited");
+  sdk_shim_time += MESH_DEVICE_FLASH_SAVE_INTERVAL*1000;
+  mesh_device_update_timestamp(test_nodes, TEST_NODES);
+  mesh_device_del(&test_nodes[TEST_NODES-1], 1);
+  test_check(mesh_device_flash_save(false) && sdk_shim_flash_erase_count == erase_count+1, "changes are written after the interval");
+  test_check(test_restart() && test_registered(TEST_NODES-1), "restart restores the newer snapshot");
+
+  // Power-loss while writing: the older snapshot stays valid
+  mesh_device_del(&test_nodes[TEST_NODES-2], 1);
+  sdk_shim_flash_write_limit = 100;
+  test_check(!mesh_device_flash_save(true), "interrupted snapshot fails");
+  sdk_shim_flash_write_limit = -1;
+  test_check(test_restart() && test_registered(TEST_NODES-1), "restart after power-loss restores the older snapshot");
+
+  // A corrupted sector is skipped as well
+  mesh_device_del(&test_nodes[TEST_NODES-2], 1);
+  test_check(mesh_device_flash_save(true), "snapshot after power-loss is written");
+  test_check(test_restart() && test_registered(TEST_NODES-2), "restart restores it");
+  first = (struct mesh_device_flash_header_type *) &sdk_shim_flash[(user_rf_cal_sector_set()-2)*SPI_FLASH_SEC_SIZE];
+  second = (struct mesh_device_flash_header_type *) &sdk_shim_flash[(user_rf_cal_sector_set()-1)*SPI_FLASH_SEC_SIZE];
+  ((uint8_t *) (first->seq > second->seq ? first : second))[sizeof(struct mesh_device_flash_header_type)] ^= 0x01; // Flip a bit of the current snapshot's first node
+  test_check(test_restart() && test_registered(TEST_NODES-1), "corrupted snapshot falls back to the older one");
+
+  mesh_device_list_release();
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,307 @@
+// mesh_device_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the registry of mesh-nodes (cf. mesh_device.c).
+// Covers the routing-tree: linking and re-parenting of nodes (incl. rejecting
+// cycles), detaching the children of a removed node, fixing up the references
+// of the tree, when the last node of the pool is moved into the place of a
+// removed one, as well as counting and listing subtrees while deletions are
+// deferred by an open iterator. Further covers the iterators over the list:
+// deleting nodes during an iteration (which is deferred until the last
+// iterator is closed and then applied as one batch) and invalidating open
+// iterators by resetting the list. Finally covers refreshing all nodes at once,
+// the coarse timestamps and (if MESH_DEVICE_OUI_COMPRESSION is enabled; cf. the
+// <name>_oui variant in the Makefile) the OUI-dictionary of the compressed
+// keys.
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "mesh_device.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define TEST_NODES 10
+#define TEST_NODE_ADDED 20
+
+static struct mesh_device_mac_type test_nodes[TEST_NODES];
+static struct mesh_device_mac_type test_root = {{0x18, 0xfe, 0x34, 0xff, 0xff, 0xff}};
+static struct mesh_device_mac_type test_unknown = {{0x18, 0xfe, 0x34, 0xff, 0x00, 0x00}};
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+// Derive a reproducible MAC-address with the Espressif-OUI from the given index
+static void test_mac(uint32_t idx, struct mesh_device_mac_type *node) {
+  node->mac[0] = 0x18;
+  node->mac[1] = 0xfe;
+  node->mac[2] = 0x34;
+  node->mac[3] = 0x00;
+  node->mac[4] = (idx >> 8) & 0xFF;
+  node->mac[5] = idx & 0xFF;
+}
+
+// Check, that the parent of the given node is the given one (NULL = unknown)
+static bool test_parent(struct mesh_device_mac_type *node, struct mesh_device_mac_type *parent) {
+  struct mesh_device_mac_type result;
+
+  if (!mesh_device_parent_get(node, &result)) {
+    return !parent;
+  }
+  return parent && !os_memcmp(&result, parent, sizeof(struct mesh_device_mac_type));
+}
+
+// Check, that the subtree of the given node consists of exactly the given test-
+// nodes (in any order) and that mesh_device_subtree_count agrees with it
+static bool test_subtree(struct mesh_device_mac_type *node, uint16_t count, ...) {
+  struct mesh_device_mac_type subtree[TEST_NODES+1];
+  uint16_t found = mesh_device_subtree_get(node, subtree, TEST_NODES+1), idx = 0, pos = 0;
+  bool result = found == count && mesh_device_subtree_count(node) == count;
+  va_list args;
+
+  va_start(args, count);
+  for (idx = 0; idx < count && result; idx++) {
+    node = &test_nodes[va_arg(args, int)];
+    for (pos = 0; pos < found && os_memcmp(&subtree[pos], node, sizeof(struct mesh_device_mac_type)); pos++);
+    result = pos < found;
+  }
+  va_end(args);
+  return result;
+}
+
+// Return the position of the given test-node in the pre-order of the subtree of
+// the given node (or TEST_NODES, if it isn't part of it)
+static uint16_t test_preorder(struct mesh_device_mac_type *top, uint16_t node) {
+  struct mesh_device_mac_type subtree[TEST_NODES+1];
+  uint16_t found = mesh_device_subtree_get(top, subtree, TEST_NODES+1), pos = 0;
+
+  for (pos = 0; pos < found && os_memcmp(&subtree[pos], &test_nodes[node], sizeof(struct mesh_device_mac_type)); pos++);
+  return pos < found ? pos : TEST_NODES;
+}
+
+// Check, whether the given test-node is contained in the given nodes
+static bool test_contains(struct mesh_device_mac_type *nodes, uint16_t count, struct mesh_device_mac_type *node) {
+  uint16_t pos = 0;
+
+  for (pos = 0; pos < count && os_memcmp(&nodes[pos], node, sizeof(struct mesh_device_mac_type)); pos++);
+  return pos < count;
+}
+
+// Collect the remaining nodes of the given iterator into the given buffer
+// (starting at the given offset) and return the total number of nodes in it
+static uint16_t test_iter_collect(struct mesh_device_iter_type *iter, struct mesh_device_mac_type *nodes, uint16_t count) {
+  struct mesh_device_node_type node;
+
+  while (count < TEST_NODES+1 && mesh_device_iter_next(iter, &node)) {
+    os_memcpy(&nodes[count++], &node.mac_addr, sizeof(struct mesh_device_mac_type));
+  }
+  return count;
+}
+
+int main(void) {
+  uint16_t idx = 0;
+  struct mesh_device_sync_type sync_result;
+  struct mesh_device_iter_type iter, iter_nested;
+  struct mesh_device_mac_type visited[TEST_NODES+1], added;
+  struct mesh_device_node_type node;
+  uint16_t visited_count = 0;
+  uint32_t age = 0;
+#if MESH_DEVICE_OUI_COMPRESSION
+  struct mesh_device_mac_type vendors[MESH_DEVICE_OUI_SLOTS];
+  struct mesh_device_stats_type stats;
+#endif
+
+  for (idx = 0; idx < TEST_NODES; idx++) {
+    test_mac(idx, &test_nodes[idx]);
+  }
+  sdk_shim_time = 1000000;
+
+  // The nodes are inserted into the pool in their order (position = index)
+  mesh_device_list_init();
+  mesh_device_sync(&test_root, test_nodes, TEST_NODES, &sync_result);
+  test_check(mesh_device_list_count() == TEST_NODES, "nodes are registered");
+  test_check(mesh_device_depth_get(&test_nodes[0]) == MESH_DEVICE_DEPTH_UNKNOWN && test_parent(&test_nodes[0], NULL), "new node isn't part of the tree yet");
+  test_check(mesh_device_depth_get(&test_root) == 0 && test_subtree(&test_root, 0), "root is alone in the tree");
+
+  // R -> 0 -> 1 -> 2, 0 -> 3, R -> 4
+  test_check(mesh_device_link(&test_nodes[0], &test_root) && mesh_device_link(&test_nodes[1], &test_nodes[0]) && mesh_device_link(&test_nodes[2], &test_nodes[1])
+             && mesh_device_link(&test_nodes[3], &test_nodes[0]) && mesh_device_link(&test_nodes[4], &test_root), "nodes are linked");
+  test_check(test_parent(&test_nodes[2], &test_nodes[1]) && test_parent(&test_nodes[0], &test_root), "parents are reported");
+  test_check(mesh_device_depth_get(&test_nodes[2]) == 3 && mesh_device_depth_get(&test_nodes[4]) == 1, "depths follow the links");
+  test_check(test_subtree(&test_nodes[0], 3, 1, 2, 3) && test_subtree(&test_root, 5, 0, 1, 2, 3, 4), "subtrees are listed and counted");
+  test_check(test_preorder(&test_root, 0) < test_preorder(&test_root, 1) && test_preorder(&test_root, 1) < test_preorder(&test_root, 2), "parents are listed before their children");
+  test_check(mesh_device_link(&test_nodes[2], &test_nodes[1]) && test_subtree(&test_root, 5, 0, 1, 2, 3, 4), "linking to the same parent changes nothing");
+
+  // Invalid links are rejected without changing the tree
+  test_check(!mesh_device_link(&test_nodes[0], &test_nodes[2]) && !mesh_device_link(&test_nodes[0], &test_nodes[0]), "links creating a cycle are rejected");
+  test_check(test_parent(&test_nodes[0], &test_root) && mesh_device_depth_get(&test_nodes[2]) == 3, "rejected link doesn't change the tree");
+  test_check(!mesh_device_link(&test_unknown, &test_root) && !mesh_device_link(&test_nodes[5], &test_unknown), "links of unregistered nodes are rejected");
+  test_check(!mesh_device_link(&test_root, &test_nodes[0]), "root can't be linked");
+
+  // Re-parenting moves the whole subtree: R -> 4 -> 1 -> 2
+  test_check(mesh_device_link(&test_nodes[1], &test_nodes[4]), "node is re-parented");
+  test_check(test_parent(&test_nodes[1], &test_nodes[4]) && mesh_device_depth_get(&test_nodes[1]) == 2 && mesh_device_depth_get(&test_nodes[2]) == 3, "subtree moves along with its depths");
+  test_check(test_subtree(&test_nodes[0], 1, 3) && test_subtree(&test_nodes[4], 2, 1, 2) && test_subtree(&test_root, 5, 0, 1, 2, 3, 4), "sizes of the old and new ancestors are updated");
+
+  // Removing a node detaches its children, which keep their own subtrees (the
+  // last node of the pool, 9, is moved into its place)
+  mesh_device_del(&test_nodes[4], 1);
+  test_check(test_parent(&test_nodes[1], NULL) && mesh_device_depth_get(&test_nodes[1]) == MESH_DEVICE_DEPTH_UNKNOWN, "children of a removed node are detached");
+  test_check(mesh_device_depth_get(&test_nodes[2]) == MESH_DEVICE_DEPTH_UNKNOWN && test_parent(&test_nodes[2], &test_nodes[1]), "their subtrees are kept, but their depth is unknown");
+  test_check(test_subtree(&test_root, 2, 0, 3) && test_subtree(&test_nodes[1], 1, 2), "detached subtrees aren't counted for the root");
+  test_check(mesh_device_link(&test_nodes[1], &test_nodes[0]) && mesh_device_depth_get(&test_nodes[2]) == 3 && test_subtree(&test_root, 4, 0, 1, 2, 3), "detached subtree is linked again");
+
+  // The last node of the pool (8) has a parent, siblings and a child, when a
+  // node (5) is removed and it is moved into that place:
+  // R -> 0 -> 3 -> {6, 8 -> 7}
+  test_check(mesh_device_link(&test_nodes[8], &test_nodes[3]) && mesh_device_link(&test_nodes[7], &test_nodes[8]) && mesh_device_link(&test_nodes[6], &test_nodes[3]), "nodes are linked below the moved one");
+  mesh_device_del(&test_nodes[5], 1);
+  test_check(test_parent(&test_nodes[8], &test_nodes[3]) && test_parent(&test_nodes[7], &test_nodes[8]) && test_parent(&test_nodes[6], &test_nodes[3]), "references to the moved node are fixed up");
+  test_check(mesh_device_depth_get(&test_nodes[7]) == 4 && test_subtree(&test_nodes[3], 3, 6, 7, 8) && test_subtree(&test_nodes[8], 1, 7), "subtree of the moved node is intact");
+  test_check(test_subtree(&test_root, 7, 0, 1, 2, 3, 6, 7, 8), "moved node is counted once");
+
+  // The moved node is removed and its child (7) is the last node of the pool
+  mesh_device_del(&test_nodes[8], 1);
+  test_check(test_parent(&test_nodes[7], NULL) && mesh_device_depth_get(&test_nodes[7]) == MESH_DEVICE_DEPTH_UNKNOWN, "detached child is moved into the place of its parent");
+  test_check(test_subtree(&test_nodes[3], 1, 6) && test_subtree(&test_root, 5, 0, 1, 2, 3, 6), "sizes are updated after the removal");
+
+  // While an iterator is open, deleted nodes remain in the tree, but are
+  // neither listed nor counted
+  mesh_device_iter_open(&iter);
+  mesh_device_del(&test_nodes[1], 1);
+  test_check(test_subtree(&test_nodes[0], 3, 2, 3, 6) && test_subtree(&test_root, 4, 0, 2, 3, 6), "deferred deletion is neither listed nor counted");
+  mesh_device_iter_close(&iter);
+  test_check(test_subtree(&test_nodes[0], 2, 3, 6) && test_parent(&test_nodes[2], NULL), "deletion is applied when the iterator is closed");
+  test_check(test_subtree(&test_root, 3, 0, 3, 6) && mesh_device_list_count() == TEST_NODES-4, "tree and list agree after the deletion");
+
+  // Nodes deleted during an iteration aren't visited anymore (unless they had
+  // already been visited) and their removal is applied, when the last one of
+  // the nested iterators is closed; nodes added during an iteration aren't
+  // visited by it (registered: 0, 2, 3, 6, 7, 9)
+  test_check(mesh_device_iter_open(&iter) && mesh_device_iter_next(&iter, &node), "iterator is opened");
+  os_memcpy(&visited[0], &node.mac_addr, sizeof(struct mesh_device_mac_type));
+  mesh_device_iter_open(&iter_nested);
+  mesh_device_del(&node.mac_addr, 1);
+  mesh_device_del(&test_nodes[3], 1);
+  mesh_device_del(&test_nodes[9], 1);
+  test_mac(TEST_NODE_ADDED, &added);
+  mesh_device_add(&added, 1);
+  test_check(mesh_device_list_count() == TEST_NODES-6 && !mesh_device_list_search(&test_nodes[3]) && mesh_device_list_search(&added), "deferred deletions are hidden from the list");
+  visited_count = test_iter_collect(&iter, visited, 1);
+  test_check(visited_count == 4 && !test_contains(visited+1, visited_count-1, &visited[0]), "iterator visits the remaining nodes once");
+  test_check(!test_contains(visited, visited_count, &test_nodes[3]) && !test_contains(visited, visited_count, &test_nodes[9]), "nodes deleted during the iteration are skipped");
+  test_check(!test_contains(visited, visited_count, &added), "nodes added during the iteration aren't visited");
+  test_check(mesh_device_iter_close(&iter) && mesh_device_list_count() == TEST_NODES-6, "first iterator is closed");
+
+  // If the deletions were applied now, the compaction of the pool would make
+  // the nested iterator skip or repeat nodes
+  visited_count = test_iter_collect(&iter_nested, visited, 0);
+  test_check(visited_count == 3 && test_contains(visited, visited_count, &test_nodes[2]) && test_contains(visited, visited_count, &test_nodes[6])
+             && test_contains(visited, visited_count, &test_nodes[7]), "deletions stay deferred while an iterator is open");
+  test_check(mesh_device_iter_close(&iter_nested) && mesh_device_list_count() == TEST_NODES-6, "deletions are applied with the last iterator");
+  test_check(!mesh_device_list_search(&test_nodes[3]) && !mesh_device_list_search(&test_nodes[9]) && mesh_device_list_search(&added), "list reflects the applied deletions");
+  mesh_device_iter_open(&iter);
+  visited_count = test_iter_collect(&iter, visited, 0);
+  mesh_device_iter_close(&iter);
+  test_check(visited_count == TEST_NODES-6 && test_contains(visited, visited_count, &added) && !test_contains(visited, visited_count, &test_nodes[3]), "new iterator visits the compacted list");
+
+  // Resetting the list invalidates the open iterators; deletions afterwards are
+  // applied immediately again
+  test_check(mesh_device_iter_open(&iter) && mesh_device_iter_next(&iter, &node), "iterator is opened before the reset");
+  mesh_device_list_release();
+  mesh_device_list_init();
+  mesh_device_sync(&test_root, test_nodes, TEST_NODES, &sync_result);
+  test_check(!mesh_device_iter_next(&iter, &node) && !mesh_device_iter_close(&iter), "reset invalidates the open iterator");
+  mesh_device_del(&test_nodes[0], 1);
+  test_check(mesh_device_list_count() == TEST_NODES-1 && !mesh_device_list_search(&test_nodes[0]), "deletion isn't deferred after the reset");
+  test_check(mesh_device_iter_open(&iter) && test_iter_collect(&iter, visited, 0) == TEST_NODES-1 && mesh_device_iter_close(&iter), "iterator over the new list is valid");
+
+  // The iterators report the timestamps as system-time (in the resolution of
+  // the stored timestamps, i.e. in seconds with MESH_DEVICE_OUI_COMPRESSION)
+  mesh_device_add(&test_nodes[0], 1);
+  sdk_shim_time += 2500000;
+  mesh_device_iter_open(&iter);
+  while (mesh_device_iter_next(&iter, &node) && os_memcmp(&node.mac_addr, &test_nodes[0], sizeof(struct mesh_device_mac_type)));
+  mesh_device_iter_close(&iter);
+  age = sdk_shim_time-node.timestamp;
+  test_check(!os_memcmp(&node.mac_addr, &test_nodes[0], sizeof(struct mesh_device_mac_type)) && age >= 1500000 && age <= 3500000, "iterator reports the timestamp as system-time");
+
+  // Refreshing the list updates the timestamps of all registered nodes at once
+  mesh_device_add(test_nodes, TEST_NODES);
+  sdk_shim_time += (SUB_NODE_TIMEOUT_THRESHOLD-2000)*1000;
+  mesh_device_refresh();
+  sdk_shim_time += (SUB_NODE_TIMEOUT_THRESHOLD-2000)*1000;
+  mesh_device_expire();
+  test_check(mesh_device_list_count() == TEST_NODES, "refreshed nodes don't expire");
+
+  // Ages are still computed correctly, after the timestamps overflowed (16 bit
+  // seconds with MESH_DEVICE_OUI_COMPRESSION, 32 bit microseconds otherwise);
+  // the clock is advanced in steps, since it has to be sampled at least once
+  // per overflow of system_get_time
+  mesh_device_del(test_nodes, TEST_NODES);
+  for (idx = 0; idx < 65; idx++) {
+    sdk_shim_time += 1000000000;
+    mesh_device_expire();
+  }
+  sdk_shim_time += 526000000;
+  mesh_device_expire();
+  mesh_device_add(&test_nodes[0], 1);
+  sdk_shim_time += 10000000;
+  mesh_device_expire();
+  mesh_device_iter_open(&iter);
+  mesh_device_iter_next(&iter, &node);
+  mesh_device_iter_close(&iter);
+  age = sdk_shim_time-node.timestamp;
+  test_check(mesh_device_list_search(&test_nodes[0]) && age >= 9000000 && age <= 11000000, "young node survives the overflow of the timestamps");
+  sdk_shim_time += SUB_NODE_TIMEOUT_THRESHOLD*1000;
+  mesh_device_expire();
+  test_check(!mesh_device_list_search(&test_nodes[0]) && mesh_device_list_count() == 0, "node expires after the overflow of the timestamps");
+
+#if MESH_DEVICE_OUI_COMPRESSION
+  // The root occupies one entry of the OUI-dictionary (shared with the test-
+  // nodes), the remaining ones are assigned to further vendors; nodes of a
+  // vendor beyond that are dropped, until an entry is free again
+  for (idx = 0; idx < MESH_DEVICE_OUI_SLOTS; idx++) {
+    test_mac(idx, &vendors[idx]);
+    vendors[idx].mac[0] = 0x02;
+    vendors[idx].mac[2] = idx;
+  }
+  test_check(mesh_device_add(vendors, MESH_DEVICE_OUI_SLOTS-1) && mesh_device_add(test_nodes, 1), "nodes of further vendors are registered");
+  mesh_device_iter_open(&iter);
+  visited_count = test_iter_collect(&iter, visited, 0);
+  mesh_device_iter_close(&iter);
+  test_check(visited_count == MESH_DEVICE_OUI_SLOTS && test_contains(visited, visited_count, &vendors[MESH_DEVICE_OUI_SLOTS-2])
+             && test_contains(visited, visited_count, &test_nodes[0]), "compressed keys are unpacked with their vendor");
+  mesh_device_stats_get(&stats);
+  age = stats.overflow_count;
+  test_check(!mesh_device_add(&vendors[MESH_DEVICE_OUI_SLOTS-1], 1) && !mesh_device_list_search(&vendors[MESH_DEVICE_OUI_SLOTS-1]), "node of a vendor beyond the dictionary is dropped");
+  mesh_device_stats_get(&stats);
+  test_check(stats.overflow_count == age+1, "dropped node is accounted as overflow");
+  mesh_device_del(vendors, 1);
+  test_check(mesh_device_add(&vendors[MESH_DEVICE_OUI_SLOTS-1], 1) && mesh_device_list_search(&vendors[MESH_DEVICE_OUI_SLOTS-1]) && !mesh_device_list_search(vendors), "entry of a vendor is reused without nodes");
+  mesh_device_iter_open(&iter);
+  visited_count = test_iter_collect(&iter, visited, 0);
+  mesh_device_iter_close(&iter);
+  test_check(visited_count == MESH_DEVICE_OUI_SLOTS && test_contains(visited, visited_count, &vendors[MESH_DEVICE_OUI_SLOTS-1]), "reused entry is unpacked with the new vendor");
+#endif
+
+  mesh_device_list_release();
+
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,558 @@
+// mesh_none_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the topology-maintenance (cf. mesh_none.c)
+// against the simulated mesh-API, timers and flash of the SDK-shim. The packets
+// sent by the simulated node are captured (cf. sdk_shim_mesh_sent_handler) and,
+// where needed, fed back into the parser after the node has switched its role.
+// Covers the splitting of the root's topology-snapshot into several parts of
+// user-options, the recovery of a node, which has missed one of them,
+// reassembling parts arriving out of order (in buffers of the pool), the root's
+// topology-deltas (user-options with the sequence-number and the joined and
+// left nodes) and applying them, ignoring duplicates and resynchronizing after
+// a gap in their sequence, the adaption of the topology-test-interval to the
+// churn (incl. keeping the nodes missing from a single topology-test at the
+// maximum interval), answering the topology-requests of child-nodes (incl.
+// postponing them, while the own device-list isn't up to date), the short reply
+// to requesters, whose device-list is already up to date, restoring the
+// device-list kept up to date by deltas after a warm restart as well as the
+// flags of the topology-packets, which mustn't pause the transmission of the
+// receiving nodes.
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "mesh.h"
+#include "esp_mesh.h"
+#include "mesh_codec.h"
+#include "mesh_device.h"
+#include "mesh_none.h"
+#include "mesh_parser.h"
+#include "mesh_pool.h"
+#include "mesh_tx.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define TEST_NODES 400        // Number of nodes of the root's device-list
+#define TEST_PART_NODES ((ESP_MESH_OP_MAX_PER_PKT-1)*MESH_NONE_USR_OPTION_NODES_MAX) // Maximum number of nodes per part of a snapshot (cf. mesh_topology_snapshot_send)
+#define TEST_PARTS ((TEST_NODES+TEST_PART_NODES-1)/TEST_PART_NODES)
+#define TEST_SENT_MAX 8       // Number of sent packets, that are captured
+
+struct test_packet_type {
+    uint8_t buf[ESP_MESH_PKT_LEN_MAX];
+    uint16_t len;
+};
+
+static struct mesh_device_mac_type test_nodes[TEST_NODES];
+static struct mesh_device_mac_type test_router = {{0x18, 0xfe, 0x34, 0xff, 0xff, 0xff}};
+static struct mesh_device_mac_type test_parent = {{0x18, 0xfe, 0x34, 0x00, 0x20, 0x00}};
+static struct mesh_device_mac_type test_joined = {{0x18, 0xfe, 0x34, 0x00, 0x30, 0x00}};
+static struct mesh_device_mac_type test_child = {{0x18, 0xfe, 0x34, 0x00, 0x40, 0x00}};
+static struct mesh_device_mac_type test_broadcast = {{0, 0, 0, 0, 0, 0}};
+static struct mesh_device_mac_type test_self;  // MAC-address of the simulated node (cf. wifi_get_macaddr)
+static struct test_packet_type test_sent[TEST_SENT_MAX];
+static uint8_t test_sent_count = 0;
+static struct espconn test_conn;
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+// Derive a reproducible MAC-address with the Espressif-OUI from the given index
+static void test_mac(uint32_t idx, struct mesh_device_mac_type *node) {
+  node->mac[0] = 0x18;
+  node->mac[1] = 0xfe;
+  node->mac[2] = 0x34;
+  node->mac[3] = 0x01;
+  node->mac[4] = (idx >> 8) & 0xFF;
+  node->mac[5] = idx & 0xFF;
+}
+
+// Capture the packets sent by the simulated node (cf. sdk_shim_mesh_sent_handler)
+static void test_sent_handler(uint8 *pdata, uint16 len) {
+  if (test_sent_count < TEST_SENT_MAX) {
+    os_memcpy(test_sent[test_sent_count].buf, pdata, len);
+    test_sent[test_sent_count].len = len;
+    test_sent_count++;
+  }
+}
+
+// Pass a packet to the parser, as if it had been received from another node
+static void test_receive(struct test_packet_type *packet) {
+  mesh_packet_parser(&test_conn, packet->buf, packet->len);
+}
+
+// Advance the system-time by the given duration (in ms) and run the expired
+// timers
+static void test_wait(uint32_t time) {
+  sdk_shim_time += time*1000;
+  sdk_shim_timers_run();
+}
+
+// Restart the topology-tests of the simulated node in the given role with an
+// empty device-list
+static void test_restart(bool root) {
+  mesh_topology_disable();
+  sdk_shim_flash_reset();
+  sdk_shim_mesh_root = root;
+  mesh_topology_init();
+  test_sent_count = 0;
+}
+
+// Initialize a packet from the given source- to the given destination-address
+// in the given buffer, which flows in the given direction (cf.
+// mesh_topology_packet_create)
+static struct mesh_header_format *test_packet_init(struct test_packet_type *packet, struct mesh_device_mac_type *dst, struct mesh_device_mac_type *src, bool upwards) {
+  mesh_codec_packet_init(packet->buf, sizeof(packet->buf), dst->mac, src->mac, os_memcmp(dst, &test_broadcast, sizeof(struct mesh_device_mac_type)) != 0, false, upwards, M_PROTO_NONE, true);
+  return (struct mesh_header_format *) packet->buf;
+}
+
+// Build a topology-request from the given source- to the given destination-
+// address, which carries the given version of the requester's device-list (if
+// versioned)
+static void test_request_build(struct test_packet_type *packet, struct mesh_device_mac_type *dst, struct mesh_device_mac_type *src, uint32_t version, bool versioned) {
+  uint8_t request_option[5] = {MESH_NONE_USR_OPTION_REQUEST, version >> 24, (version >> 16) & 0xFF, (version >> 8) & 0xFF, version & 0xFF};
+  struct mesh_header_format *header = test_packet_init(packet, dst, src, true);
+
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, request_option, versioned ? sizeof(request_option) : 1);
+  packet->len = header->len;
+}
+
+// Build a topology-delta of the root with the given sequence-number, which adds
+// the given node
+static void test_delta_build(struct test_packet_type *packet, uint16_t seq, struct mesh_device_mac_type *node) {
+  uint8_t seq_option[4] = {MESH_NONE_USR_OPTION_SEQ, seq >> 8, seq & 0xFF, 0};
+  uint8_t add_option[1+sizeof(struct mesh_device_mac_type)] = {MESH_NONE_USR_OPTION_ADD};
+  struct mesh_header_format *header = test_packet_init(packet, &test_broadcast, &test_self, false);
+
+  os_memcpy(&add_option[1], node, sizeof(struct mesh_device_mac_type));
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, seq_option, sizeof(seq_option));
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, add_option, sizeof(add_option));
+  packet->len = header->len;
+}
+
+// Return the user-option of the given subtype carried by the given packet (or
+// NULL, if there is none)
+static struct mesh_header_option_format *test_usr_option(struct test_packet_type *packet, uint8_t subtype) {
+  struct mesh_header_option_format *option = NULL;
+  uint16_t idx = 1;
+
+  while ((option = mesh_codec_option_find((struct mesh_header_format *) packet->buf, M_O_USR_OPTION, idx++))) {
+    if (option->olen >= 1 && option->ovalue[0] == subtype) {
+      return option;
+    }
+  }
+  return NULL;
+}
+
+// Check, that the given packet is the given part of the root's snapshot, which
+// only consists of user-options of the maximum length; return the number of
+// nodes of the part (or 0, if it is invalid)
+static uint16_t test_part_check(struct test_packet_type *packet, uint8_t part) {
+  struct mesh_header_format *header = (struct mesh_header_format *) packet->buf;
+  struct mesh_header_option_format *option = NULL;
+  uint16_t offset = 0, count = 0;
+  bool valid = packet->len <= ESP_MESH_PKT_LEN_MAX, snapshot = false;
+
+  while (valid && (option = mesh_codec_option_next(header, &offset))) {
+    if (option->otype != M_O_USR_OPTION || option->olen < 1) {
+      valid = false;
+    }
+    else if (option->ovalue[0] == MESH_NONE_USR_OPTION_SNAPSHOT) {
+      valid = !snapshot && count == 0 && option->ovalue[4] == part && option->ovalue[5] == TEST_PARTS;
+      snapshot = true;
+    }
+    else if (option->ovalue[0] == MESH_NONE_USR_OPTION_NODES) {
+      valid = (option->olen-1)%sizeof(struct mesh_device_mac_type) == 0 && (option->olen-1)/sizeof(struct mesh_device_mac_type) <= MESH_NONE_USR_OPTION_NODES_MAX;
+      count += (option->olen-1)/sizeof(struct mesh_device_mac_type);
+    }
+  }
+  return valid && snapshot ? count : 0;
+}
+
+// Return the number of captured packets to the given destination-address, whose
+// first user-option has the given subtype
+static uint8_t test_sent_to(struct mesh_device_mac_type *dst, uint8_t subtype) {
+  struct mesh_header_option_format *option = NULL;
+  uint8_t idx = 0, count = 0;
+
+  for (idx = 0; idx < test_sent_count; idx++) {
+    option = mesh_codec_option_find((struct mesh_header_format *) test_sent[idx].buf, M_O_USR_OPTION, 1);
+    if (!os_memcmp(((struct mesh_header_format *) test_sent[idx].buf)->dst_addr, dst, sizeof(struct mesh_device_mac_type)) && option && option->olen >= 1 && option->ovalue[0] == subtype) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Return the sequence-number of the root's next delta carried by the given
+// part of a snapshot
+static uint16_t test_part_seq(struct test_packet_type *packet) {
+  struct mesh_header_option_format *option = test_usr_option(packet, MESH_NONE_USR_OPTION_SNAPSHOT);
+
+  return (option->ovalue[1] << 8) | option->ovalue[2];
+}
+
+int main(void) {
+  uint16_t idx = 0, count = 0, seq = 0;
+  uint32_t requests = 0, interval = 0, received = 0, relays = 0, unchanged = 0, sent_count = 0;
+  uint8_t waits = 0, sent = 0;
+  bool registered = true, doubled = true;
+  struct mesh_device_mac_type node, sub_nodes[3];
+  struct mesh_header_option_format *option = NULL;
+  struct mesh_header_format *header = NULL;
+  struct mesh_tx_stats_type tx_stats;
+  struct mesh_pool_stats_type pool_stats;
+  struct test_packet_type packet, reply, parts[TEST_PARTS], deltas[TEST_SENT_MAX];
+  struct mesh_device_sync_type sync_result;
+  struct mesh_topology_stats_type stats;
+
+  for (idx = 0; idx < TEST_NODES; idx++) {
+    test_mac(idx, &test_nodes[idx]);
+  }
+  wifi_get_macaddr(STATION_IF, test_self.mac);
+  os_memcpy(sdk_shim_mesh_parent, test_parent.mac, sizeof(sdk_shim_mesh_parent));
+  sdk_shim_mesh_sent_handler = test_sent_handler;
+  sdk_shim_time = 1000000;
+  esp_mesh_conn = &test_conn;
+
+  // Snapshot of the root: the topology-requests are collected and answered by a
+  // single snapshot, which is split into parts of full user-options
+  test_restart(true);
+  mesh_device_sync(&test_router, test_nodes, TEST_NODES, &sync_result);
+  test_request_build(&packet, &test_broadcast, &test_nodes[0], 0, false);
+  test_receive(&packet);
+  test_request_build(&packet, &test_broadcast, &test_nodes[1], 0, false);
+  test_receive(&packet);
+  test_check(test_sent_count == 0, "root collects the topology-requests");
+  test_wait(TOPOLOGY_SNAPSHOT_WINDOW);
+  test_check(test_sent_count == TEST_PARTS, "snapshot is split into the expected number of parts");
+  for (idx = 0; idx < TEST_PARTS && idx < test_sent_count; idx++) {
+    os_memcpy(&parts[idx], &test_sent[idx], sizeof(struct test_packet_type));
+    count += test_part_check(&parts[idx], idx);
+  }
+  test_check(count == TEST_NODES, "parts are numbered and carry all nodes in user-options");
+  seq = test_part_seq(&parts[0]);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.snapshot_count == 1, "snapshot is counted once");
+
+  // A new node broadcasts a topology-request with its parent-node; if it misses
+  // a part, it discards the snapshot and requests a new one
+  sdk_shim_mesh_root = false;
+  sdk_shim_mesh_parent_known = true;
+  test_restart(false);
+  test_wait(TOPOLOGY_TIME_INTERVAL);
+  mesh_topology_stats_get(&stats);
+  requests = stats.request_count;
+  test_check(requests == 1 && test_sent_count == 1 && test_usr_option(&test_sent[0], MESH_NONE_USR_OPTION_REQUEST), "new node broadcasts a topology-request");
+  option = test_usr_option(&test_sent[0], MESH_NONE_USR_OPTION_PARENT);
+  test_check(option && option->olen == 1+sizeof(struct mesh_device_mac_type), "topology-request carries the parent-node");
+  header = (struct mesh_header_format *) test_sent[0].buf;
+  test_check(header->proto.d && !header->cr, "topology-request flows upwards without congestion-request");
+  test_receive(&parts[0]);
+  test_receive(&parts[TEST_PARTS-1]);
+  test_delta_build(&packet, seq, &test_joined);
+  test_receive(&packet);
+  test_check(!mesh_device_list_search(&test_joined), "delta isn't applied after an incomplete snapshot");
+  test_wait(stats.interval);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.request_count == requests+1, "node requests again after an incomplete snapshot");
+  requests = stats.request_count;
+
+  // Parts arriving ahead of a missing one are buffered (TEST_PARTS-1 mustn't
+  // exceed TOPOLOGY_SNAPSHOT_BUFFERS), until it arrives; an incomplete snapshot
+  // is discarded after TOPOLOGY_SNAPSHOT_TIMEOUT
+  test_wait(TOPOLOGY_SNAPSHOT_TIMEOUT);
+  test_receive(&parts[1]);
+  test_check(mesh_device_list_count() < TEST_NODES, "incomplete snapshot is discarded after the timeout");
+  for (idx = TEST_PARTS-1; idx > 1; idx--) {
+    test_receive(&parts[idx]);
+  }
+  test_receive(&parts[0]);
+  for (idx = 0; idx < TEST_NODES; idx++) {
+    registered &= mesh_device_list_search(&test_nodes[idx]);
+  }
+  test_check(registered && mesh_device_list_count() == TEST_NODES, "parts arriving out of order are reassembled");
+  mesh_pool_stats_get(MESH_POOL_LARGE, &pool_stats);
+  test_check(pool_stats.used == 0, "buffered parts are released");
+
+  // The complete snapshot is applied and the node continues with the deltas
+  for (idx = 0; idx < TEST_PARTS; idx++) {
+    test_receive(&parts[idx]);
+  }
+  for (idx = 0; idx < TEST_NODES; idx++) {
+    registered &= mesh_device_list_search(&test_nodes[idx]);
+  }
+  test_check(registered && mesh_device_list_count() == TEST_NODES, "complete snapshot registers all nodes");
+  test_receive(&packet);
+  test_check(mesh_device_list_search(&test_joined), "delta following the snapshot is applied");
+  test_wait(stats.interval);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.request_count == requests, "synchronized node doesn't request again");
+
+  // Consecutive deltas are applied and duplicates ignored; a gap in the sequence
+  // stops applying them until the node has been resynchronized
+  seq++;
+  test_mac(TEST_NODES, &node);
+  test_delta_build(&packet, seq, &node);
+  test_receive(&packet);
+  test_check(mesh_device_list_search(&node), "consecutive delta is applied");
+  test_mac(TEST_NODES+1, &node);
+  test_delta_build(&packet, seq, &node);
+  test_receive(&packet);
+  test_check(!mesh_device_list_search(&node), "duplicate delta is ignored");
+  test_delta_build(&packet, seq+2, &node);
+  test_receive(&packet);
+  test_check(!mesh_device_list_search(&node), "delta after a gap isn't applied");
+  mesh_topology_stats_get(&stats);
+  requests = stats.request_count;
+  test_wait(stats.interval);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.request_count == requests+1, "gap causes a new topology-request");
+  test_delta_build(&packet, seq+3, &node);
+  test_receive(&packet);
+  test_check(!mesh_device_list_search(&node), "deltas aren't applied until resynchronized");
+
+  // The interval of the topology-tests is doubled as long as nothing changes and
+  // dropped back to the fast one by a change or mesh_topology_trigger
+  mesh_topology_stats_get(&stats);
+  while (stats.interval < TOPOLOGY_TIME_INTERVAL_MAX && waits++ < 16) {
+    interval = stats.interval;
+    test_wait(interval);
+    mesh_topology_stats_get(&stats);
+    doubled &= stats.interval == 2*interval;
+  }
+  test_check(doubled && stats.interval == TOPOLOGY_TIME_INTERVAL_MAX, "interval is doubled while nothing changes");
+  test_wait(stats.interval);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.interval == TOPOLOGY_TIME_INTERVAL_MAX, "interval is limited to TOPOLOGY_TIME_INTERVAL_MAX");
+  mesh_topology_trigger();
+  mesh_topology_stats_get(&stats);
+  requests = stats.request_count;
+  test_check(stats.interval == TOPOLOGY_TIME_INTERVAL, "trigger drops back to the fast interval");
+  test_wait(TOPOLOGY_TIME_INTERVAL);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.request_count == requests+1 && stats.interval == 2*TOPOLOGY_TIME_INTERVAL, "next topology-test follows after the fast interval");
+  test_wait(stats.interval);
+  test_mac(TEST_NODES+2, &node);
+  mesh_device_add(&node, 1);
+  mesh_topology_stats_get(&stats);
+  test_wait(stats.interval);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.interval == TOPOLOGY_TIME_INTERVAL && stats.change_count > 0, "change of the device-list drops back to the fast interval");
+
+  // Requests of child-nodes are postponed, while the node isn't synchronized,
+  // and answered from the own device-list afterwards; broadcasted ones are left
+  // to the root
+  relays = stats.relay_count;
+  test_sent_count = 0;
+  test_request_build(&packet, &test_self, &test_child, 0, true);
+  test_receive(&packet);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.relay_count == relays && test_sent_count == 0, "request of a child is postponed while not synchronized");
+  for (idx = 0; idx < TEST_PARTS; idx++) {
+    test_receive(&parts[idx]);
+  }
+  mesh_topology_stats_get(&stats);
+  test_check(stats.relay_count == relays+1 && test_sent_to(&test_child, MESH_NONE_USR_OPTION_SNAPSHOT) == TEST_PARTS, "postponed request is answered after the resynchronization");
+  test_sent_count = 0;
+  test_request_build(&packet, &test_self, &test_child, 0, false);
+  test_receive(&packet);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.relay_count == relays+2 && test_sent_to(&test_child, MESH_NONE_USR_OPTION_SNAPSHOT) == TEST_PARTS, "synchronized node answers a request right away");
+  test_sent_count = 0;
+  test_request_build(&packet, &test_broadcast, &test_child, 0, false);
+  test_receive(&packet);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.relay_count == relays+2 && test_sent_count == 0, "broadcasted request is left to the root");
+
+  // Without a delta from the root, the own device-list turns stale and isn't
+  // relayed anymore
+  test_wait(stats.interval);
+  mesh_topology_stats_get(&stats);
+  test_wait(stats.interval);
+  test_sent_count = 0;
+  test_request_build(&packet, &test_self, &test_child, 0, false);
+  test_receive(&packet);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.relay_count == relays+2 && test_sent_count == 0, "stale device-list isn't relayed");
+
+  // A requester, whose device-list matches the own one, only gets the short
+  // reply, which resynchronizes a node with that device-list
+  for (idx = 0; idx < TEST_PARTS; idx++) {
+    test_receive(&parts[idx]);
+  }
+  seq = test_part_seq(&parts[0]);
+  mesh_topology_stats_get(&stats);
+  unchanged = stats.unchanged_count;
+  test_sent_count = 0;
+  test_request_build(&packet, &test_self, &test_child, mesh_device_list_version(), true);
+  test_receive(&packet);
+  mesh_topology_stats_get(&stats);
+  test_check(stats.unchanged_count == unchanged+1 && test_sent_count == 1 && test_sent_to(&test_child, MESH_NONE_USR_OPTION_UNCHANGED) == 1, "up-to-date requester gets the short reply");
+  os_memcpy(&reply, &test_sent[0], sizeof(struct test_packet_type));
+  test_check(reply.len < parts[TEST_PARTS-1].len, "short reply is smaller than a snapshot");
+  test_mac(TEST_NODES+3, &node);
+  test_delta_build(&packet, seq+2, &node);
+  test_receive(&packet);
+  test_receive(&reply);
+  test_delta_build(&packet, seq, &node);
+  test_receive(&packet);
+  test_check(mesh_device_list_search(&node), "short reply resynchronizes a node with that version");
+  test_mac(TEST_NODES+4, &node);
+  test_delta_build(&packet, seq+2, &node);
+  test_receive(&packet);
+  test_receive(&reply);
+  test_delta_build(&packet, seq+1, &node);
+  test_receive(&packet);
+  test_check(!mesh_device_list_search(&node), "short reply for another version is ignored");
+
+  // The backoff-level announced by the root is limited to the one of
+  // TOPOLOGY_TIME_INTERVAL_MAX, before the node passes it on
+  for (idx = 0; idx < TEST_PARTS; idx++) {
+    test_receive(&parts[idx]);
+  }
+  test_delta_build(&packet, test_part_seq(&parts[0]), &node);
+  test_usr_option(&packet, MESH_NONE_USR_OPTION_SEQ)->ovalue[3] = 0xFF;
+  test_receive(&packet);
+  test_sent_count = 0;
+  test_request_build(&packet, &test_self, &test_child, mesh_device_list_version(), true);
+  test_receive(&packet);
+  option = test_usr_option(&test_sent[0], MESH_NONE_USR_OPTION_UNCHANGED);
+  test_check(test_sent_count == 1 && option && option->ovalue[3] < 32 && ((uint32_t) TOPOLOGY_TIME_INTERVAL << option->ovalue[3]) <= TOPOLOGY_TIME_INTERVAL_MAX, "root's backoff-level is limited to the maximum interval");
+
+  // Without a delta from the root, the node falls back to a topology-request
+  // after TOPOLOGY_DELTA_TIMEOUT of the root's intervals
+  for (idx = 0; idx < TEST_PARTS; idx++) {
+    test_receive(&parts[idx]);
+  }
+  received = sdk_shim_time;
+  mesh_topology_stats_get(&stats);
+  requests = stats.request_count;
+  waits = 0;
+  while (stats.request_count == requests && waits++ < 16) {
+    test_wait(stats.interval);
+    mesh_topology_stats_get(&stats);
+  }
+  test_check(stats.request_count == requests+1 && sdk_shim_time-received >= TOPOLOGY_DELTA_TIMEOUT*TOPOLOGY_TIME_INTERVAL*1000, "missing deltas cause a new topology-request");
+
+  // The deltas confirm the registered nodes, so that all of them are kept
+  // beyond the timeout-threshold and restored after a warm restart
+  for (idx = 0; idx < TEST_PARTS; idx++) {
+    test_receive(&parts[idx]);
+  }
+  seq = test_part_seq(&parts[0]);
+  for (waits = 0; waits < 4; waits++) {
+    test_wait(TOPOLOGY_TIME_INTERVAL);
+    test_delta_build(&packet, seq++, &test_joined);
+    test_receive(&packet);
+  }
+  count = mesh_device_list_count();
+  test_check(mesh_device_expire() == 0 && mesh_device_list_count() == count, "deltas keep the device-list beyond the timeout-threshold");
+  mesh_topology_disable();
+  mesh_topology_init();
+  test_check(mesh_device_list_count() == count, "warm restart after the deltas restores all nodes");
+
+  // At the maximum interval, a node missing from a single topology-test of the
+  // root isn't deleted, and a warm restart between two topology-tests restores
+  // all nodes
+  test_restart(true);
+  os_memcpy(&sub_nodes[0], &test_router, sizeof(struct mesh_device_mac_type));
+  os_memcpy(&sub_nodes[1], &test_nodes[0], 2*sizeof(struct mesh_device_mac_type));
+  sdk_shim_mesh_nodes = (uint8 *) sub_nodes;
+  sdk_shim_mesh_node_count = 3;
+  mesh_topology_stats_get(&stats);
+  waits = 0;
+  while (stats.interval < TOPOLOGY_TIME_INTERVAL_MAX && waits++ < 16) {
+    test_wait(stats.interval);
+    mesh_topology_stats_get(&stats);
+  }
+  test_check(stats.interval == TOPOLOGY_TIME_INTERVAL_MAX && mesh_device_list_count() == 2, "root backs off to the maximum interval");
+  sdk_shim_mesh_node_count = 2;
+  test_wait(TOPOLOGY_TIME_INTERVAL_MAX);
+  sdk_shim_mesh_node_count = 3;
+  test_check(mesh_device_list_search(&test_nodes[1]), "node missing from one topology-test isn't deleted");
+  test_wait(TOPOLOGY_TIME_INTERVAL_MAX);
+  mesh_topology_stats_get(&stats);
+  test_check(mesh_device_list_count() == 2 && stats.interval == TOPOLOGY_TIME_INTERVAL_MAX, "it is confirmed by the next one");
+  test_wait(TOPOLOGY_TIME_INTERVAL_MAX/2);
+  mesh_device_add(&test_nodes[2], 1);  // Changes the list, so that it is written to flash on disabling
+  mesh_topology_disable();
+  mesh_topology_init();
+  sdk_shim_mesh_nodes = NULL;
+  test_check(mesh_device_list_count() == 3, "warm restart between two topology-tests restores all nodes");
+
+  // The root broadcasts the nodes joining and leaving its device-list as
+  // user-options of its deltas, which a node synchronized with its snapshot
+  // applies
+  test_restart(true);
+  test_request_build(&packet, &test_broadcast, &test_nodes[0], 0, false);
+  test_receive(&packet);
+  test_wait(TOPOLOGY_SNAPSHOT_WINDOW);
+  os_memcpy(&parts[0], &test_sent[0], sizeof(struct test_packet_type));
+  test_check(test_sent_count == 1 && test_usr_option(&parts[0], MESH_NONE_USR_OPTION_SNAPSHOT) && !test_usr_option(&parts[0], MESH_NONE_USR_OPTION_NODES), "empty device-list is sent as a single part");
+  test_sent_count = 0;
+  sdk_shim_mesh_nodes = (uint8 *) sub_nodes;
+  sdk_shim_mesh_node_count = 3;
+  test_wait(TOPOLOGY_TIME_INTERVAL-TOPOLOGY_SNAPSHOT_WINDOW);
+  sdk_shim_mesh_node_count = 2;
+  mesh_topology_stats_get(&stats);
+  waits = 0;
+  while (mesh_device_list_search(&test_nodes[1]) && waits++ < 16) {
+    test_wait(stats.interval);
+    mesh_topology_stats_get(&stats);
+  }
+  sdk_shim_mesh_nodes = NULL;
+  sent = test_sent_count;
+  test_check(sent == waits+1 && sent < TEST_SENT_MAX, "root broadcasts a delta every topology-test");
+  option = test_usr_option(&test_sent[0], MESH_NONE_USR_OPTION_ADD);
+  test_check(test_usr_option(&test_sent[0], MESH_NONE_USR_OPTION_SEQ) && option && option->olen == 1+2*sizeof(struct mesh_device_mac_type), "delta carries the joined nodes in a user-option");
+  option = test_usr_option(&test_sent[sent-1], MESH_NONE_USR_OPTION_DEL);
+  test_check(option && option->olen == 1+sizeof(struct mesh_device_mac_type) && !os_memcmp(&option->ovalue[1], &test_nodes[1], sizeof(struct mesh_device_mac_type)), "delta carries the left node in a user-option");
+  header = (struct mesh_header_format *) test_sent[0].buf;
+  test_check(!header->proto.d && !header->cr, "delta flows downwards without congestion-request");
+  os_memcpy(deltas, test_sent, sizeof(deltas));
+  sdk_shim_mesh_root = false;
+  test_restart(false);
+  test_receive(&parts[0]);
+  for (idx = 0; idx < sent; idx++) {
+    test_receive(&deltas[idx]);
+    if (idx == 0) {
+      registered = mesh_device_list_search(&test_nodes[1]);
+    }
+  }
+  test_check(registered && mesh_device_list_search(&test_nodes[0]) && !mesh_device_list_search(&test_nodes[1]), "node applies the root's deltas");
+
+  // The root's delta doesn't pause the transmission of a node, even if its
+  // parent-node passes it on
+  test_restart(false);
+  mesh_tx_init();
+  header = (struct mesh_header_format *) deltas[0].buf;
+  os_memcpy(header->src_addr, test_parent.mac, sizeof(struct mesh_device_mac_type));
+  test_receive(&deltas[0]);
+  sent_count = sdk_shim_mesh_sent_count;
+  test_request_build(&packet, &test_parent, &test_self, 0, false);
+  mesh_tx_send(&test_conn, packet.buf, packet.len);
+  mesh_tx_stats_get(&tx_stats);
+  test_check(tx_stats.pauses == 0 && sdk_shim_mesh_sent_count == sent_count+1, "node sends right away after receiving the delta");
+  mesh_tx_release();
+
+  mesh_topology_disable();
+  sdk_shim_mesh_sent_handler = NULL;
+
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,414 @@
+// mesh_parser_bench.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side benchmark and fuzz-harness of the receive-path (cf.
+// mesh_parser.c and mesh_none.c). Synthetic packets (topology-snapshots,
+// -deltas, -requests of child-nodes as well as truncated packets and packets of
+// another version, which have to be counted as drops) are passed through
+// mesh_packet_parser into the real handlers of a simulated non-root-node and
+// the throughput (packets/s) as well as the duration per packet (ns and TSC-
+// cycles, if available) are measured.
+//
+// Afterwards, randomly mutated versions of these packets are fed into the
+// parser; a packet, which is malformed (cf. mesh_codec.h), has to be rejected
+// by the parser, before it reaches a handler or the device-list. The same
+// check is run by LLVMFuzzerTestOneInput, so that the file can be built for
+// coverage-guided fuzzing with libFuzzer as well (make fuzz; the first byte of
+// every input selects, whether the node is the root). Given files are replayed
+// instead (e.g. a crash-reproducer or the corpus of another fuzzer).
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "mesh.h"
+#include "esp_mesh.h"
+#include "mesh_codec.h"
+#include "mesh_device.h"
+#include "mesh_none.h"
+#include "mesh_parser.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define BENCH_PACKETS 100000        // Number of packets per measurement
+#define BENCH_SNAPSHOT_NODES 160u   // Number of nodes of the snapshot (4 options)
+#define BENCH_FUZZ_PACKETS 200000   // Number of mutated packets
+#define BENCH_FUZZ_MUTATIONS 4      // Maximum number of mutations per packet
+
+#define BENCH_SEED_SNAPSHOT 0
+#define BENCH_SEED_DELTA 1
+#define BENCH_SEED_REQUEST 2
+#define BENCH_SEEDS 3
+
+struct bench_packet_type {
+    uint8_t buf[ESP_MESH_PKT_LEN_MAX];
+    uint16_t len;
+};
+
+static struct mesh_device_mac_type bench_root = {{0x18, 0xfe, 0x34, 0xff, 0xff, 0xff}};
+static struct mesh_device_mac_type bench_self;  // MAC-address of the simulated node (cf. wifi_get_macaddr)
+static struct mesh_device_mac_type bench_child = {{0x18, 0xfe, 0x34, 0x00, 0x10, 0x00}};
+static struct mesh_device_mac_type bench_nodes[BENCH_SNAPSHOT_NODES];
+
+static struct bench_packet_type bench_seeds[BENCH_SEEDS];
+static struct espconn bench_conn;
+static uint32_t bench_rng = 2463534242u;
+static uint16_t bench_failures = 0;
+
+// Return the TSC of the host (0, if it isn't available)
+static uint64_t bench_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Pseudo-random number (xorshift), so that the mutations are reproducible
+static uint32_t bench_random(void) {
+  bench_rng ^= bench_rng << 13;
+  bench_rng ^= bench_rng >> 17;
+  bench_rng ^= bench_rng << 5;
+  return bench_rng;
+}
+
+// Derive a reproducible MAC-address with the Espressif-OUI from the given index
+static void bench_mac(uint32_t idx, struct mesh_device_mac_type *node) {
+  node->mac[0] = 0x18;
+  node->mac[1] = 0xfe;
+  node->mac[2] = 0x34;
+  node->mac[3] = 0x01;
+  node->mac[4] = (idx >> 8) & 0xFF;
+  node->mac[5] = idx & 0xFF;
+}
+
+// Build a single-part topology-snapshot of the root with the given sequence-
+// number
+static void bench_snapshot_build(struct bench_packet_type *packet, uint16_t seq) {
+  struct mesh_header_format *header = (struct mesh_header_format *) packet->buf;
+  uint8_t option[6+sizeof(struct mesh_device_mac_type)] = {MESH_NONE_USR_OPTION_SNAPSHOT, seq >> 8, seq & 0xFF, 0, 0, 1};
+  uint8_t nodes_option[1+MESH_NONE_USR_OPTION_NODES_MAX*sizeof(struct mesh_device_mac_type)] = {MESH_NONE_USR_OPTION_NODES};
+  uint16_t idx = 0, count = 0;
+
+  os_memcpy(&option[6], &bench_root, sizeof(struct mesh_device_mac_type));
+  mesh_codec_packet_init(packet->buf, sizeof(packet->buf), (uint8_t *) "\0\0\0\0\0\0", bench_root.mac, false, false, false, M_PROTO_NONE, true);
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, option, sizeof(option));
+  for (idx = 0; idx < BENCH_SNAPSHOT_NODES; idx += MESH_NONE_USR_OPTION_NODES_MAX) {
+    count = BENCH_SNAPSHOT_NODES-idx < MESH_NONE_USR_OPTION_NODES_MAX ? BENCH_SNAPSHOT_NODES-idx : MESH_NONE_USR_OPTION_NODES_MAX;
+    os_memcpy(&nodes_option[1], &bench_nodes[idx], count*sizeof(struct mesh_device_mac_type));
+    mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, nodes_option, 1+count*sizeof(struct mesh_device_mac_type));
+  }
+  packet->len = header->len;
+}
+
+// Build a topology-delta of the root with the given sequence-number, which
+// adds a node and deletes it again
+static void bench_delta_build(struct bench_packet_type *packet, uint16_t seq) {
+  struct mesh_header_format *header = (struct mesh_header_format *) packet->buf;
+  uint8_t option[4] = {MESH_NONE_USR_OPTION_SEQ, seq >> 8, seq & 0xFF, 0};
+  uint8_t add_option[1+sizeof(struct mesh_device_mac_type)] = {MESH_NONE_USR_OPTION_ADD};
+  uint8_t del_option[1+sizeof(struct mesh_device_mac_type)] = {MESH_NONE_USR_OPTION_DEL};
+
+  os_memcpy(&add_option[1], &bench_child, sizeof(struct mesh_device_mac_type));
+  os_memcpy(&del_option[1], &bench_child, sizeof(struct mesh_device_mac_type));
+  mesh_codec_packet_init(packet->buf, sizeof(packet->buf), (uint8_t *) "\0\0\0\0\0\0", bench_root.mac, false, false, false, M_PROTO_NONE, true);
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, option, sizeof(option));
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, add_option, sizeof(add_option));
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, del_option, sizeof(del_option));
+  packet->len = header->len;
+}
+
+// Build the topology-request of a child-node with the current version of the
+// device-list, which the simulated node answers from its own device-list
+static void bench_request_build(struct bench_packet_type *packet) {
+  struct mesh_header_format *header = (struct mesh_header_format *) packet->buf;
+  uint32_t version = mesh_device_list_version();
+  uint8_t request_option[5] = {MESH_NONE_USR_OPTION_REQUEST, version >> 24, (version >> 16) & 0xFF, (version >> 8) & 0xFF, version & 0xFF};
+  uint8_t parent_option[1+sizeof(struct mesh_device_mac_type)] = {MESH_NONE_USR_OPTION_PARENT};
+
+  os_memcpy(&parent_option[1], &bench_self, sizeof(struct mesh_device_mac_type));
+  mesh_codec_packet_init(packet->buf, sizeof(packet->buf), bench_self.mac, bench_child.mac, true, false, true, M_PROTO_NONE, true);
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, request_option, sizeof(request_option));
+  mesh_codec_option_append(header, sizeof(packet->buf), M_O_USR_OPTION, parent_option, sizeof(parent_option));
+  packet->len = header->len;
+}
+
+// Set up the simulated non-root-node with an empty device-list
+static void bench_setup(void) {
+  uint16_t idx = 0;
+
+  for (idx = 0; idx < BENCH_SNAPSHOT_NODES; idx++) {
+    bench_mac(idx, &bench_nodes[idx]);
+  }
+  wifi_get_macaddr(STATION_IF, bench_self.mac);
+  sdk_shim_flash_reset();
+  sdk_shim_time = 1000000;
+  sdk_shim_mesh_root = false;
+  esp_mesh_conn = &bench_conn;
+  mesh_topology_init();
+}
+
+// Check, whether the parser has to reject the given packet (cf. mesh_codec.h)
+static bool bench_malformed(uint8_t *buf, uint16_t len) {
+  struct mesh_header_format *header = (struct mesh_header_format *) buf;
+  uint16_t offset = 0, count = 0;
+
+  if (len < ESP_MESH_HLEN || len > ESP_MESH_PKT_LEN_MAX || header->ver != ESP_MESH_VER || !mesh_codec_header_check(header, len)) {
+    return true;
+  }
+  while (mesh_codec_option_next(header, &offset)) {
+    count++;
+  }
+  return !mesh_codec_options_end(header, offset) || count > MESH_PARSER_OPTIONS_MAX;
+}
+
+// Pass a single packet to the parser and check, that a malformed one has been
+// rejected before reaching a handler or the device-list; return false, if it
+// has been rejected
+static bool bench_fuzz_one(uint8_t *buf, uint16_t len) {
+  uint32_t hits = mesh_parser_hits_get(M_PROTO_NONE);
+  uint32_t version = mesh_device_list_version();
+  bool malformed = bench_malformed(buf, len);
+
+  mesh_packet_parser(&bench_conn, buf, len);
+  if (malformed && (mesh_parser_hits_get(M_PROTO_NONE) != hits || mesh_device_list_version() != version)) {
+    printf("malformed packet of %d bytes reached the handler\n", len);
+    abort();
+  }
+  return mesh_parser_hits_get(M_PROTO_NONE) != hits;
+}
+
+// Entry-point of libFuzzer
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static bool initialized = false;
+  static uint8_t buf[ESP_MESH_PKT_LEN_MAX];
+
+  if (!initialized) {
+    bench_setup();
+    initialized = true;
+  }
+  if (size < 1 || size > 1+sizeof(buf)) {
+    return 0;
+  }
+
+  sdk_shim_mesh_root = data[0] & 0x01;
+  os_memcpy(buf, data+1, size-1);
+  bench_fuzz_one(buf, size-1);
+  sdk_shim_time += 1000;
+  return 0;
+}
+
+#ifndef MESH_PARSER_FUZZ
+
+// Print a result-line
+static void bench_report(const char *packet, uint64_t ns, uint64_t cycles, uint32_t count) {
+  printf("%-22s %10.1f %12.0f ", packet, (double) ns/count, count*1e9/ns);
+  if (cycles > 0) {
+    printf("%12.0f\n", (double) cycles/count);
+  }
+  else {
+    printf("%12s\n", "-");
+  }
+}
+
+// Measure the given number of packets; build is called before every packet
+// (outside of the measurement) to update it, if it isn't NULL
+static void bench_measure(const char *name, struct bench_packet_type *packet, void (*build)(struct bench_packet_type *, uint32_t), uint32_t count) {
+  uint32_t idx = 0;
+  uint64_t ns = 0, cycles = 0, start_ns = 0, start_cycles = 0;
+
+  for (idx = 0; idx < count; idx++) {
+    if (build) {
+      build(packet, idx);
+    }
+    start_ns = sdk_shim_clock_ns();
+    start_cycles = bench_cycles();
+    mesh_packet_parser(&bench_conn, packet->buf, packet->len);
+    cycles += bench_cycles()-start_cycles;
+    ns += sdk_shim_clock_ns()-start_ns;
+  }
+  bench_report(name, ns, cycles, count);
+}
+
+static uint16_t bench_seq = 0x100;  // Sequence-number of the root's next delta
+
+// Snapshot, that is applied (its sequence-number leaves a gap)
+static void bench_snapshot_next(struct bench_packet_type *packet, uint32_t idx) {
+  bench_seq += 2;
+  bench_snapshot_build(packet, bench_seq);
+}
+
+// Delta following the last one
+static void bench_delta_next(struct bench_packet_type *packet, uint32_t idx) {
+  bench_delta_build(packet, bench_seq++);
+}
+
+static void bench_run(void) {
+  struct bench_packet_type packet;
+  uint32_t sent = 0, drops = 0, allocs = 0, prints = 0;
+
+  printf("%-22s %10s %12s %12s\n", "packet", "ns/packet", "packets/s", "cycles/pkt");
+
+  bench_measure("snapshot (applied)", &packet, bench_snapshot_next, BENCH_PACKETS/10);
+
+  // The node is up to date: a snapshot with the next sequence-number is skipped
+  bench_snapshot_build(&packet, bench_seq);
+  bench_measure("snapshot (skipped)", &packet, NULL, BENCH_PACKETS);
+
+  bench_measure("delta", &packet, bench_delta_next, BENCH_PACKETS);
+
+  // The requests are answered by the short reply, since the version matches
+  bench_request_build(&packet);
+  sent = sdk_shim_mesh_sent_count;
+  allocs = sdk_shim_alloc_count;
+  bench_measure("request (relayed)", &packet, NULL, BENCH_PACKETS);
+  if (sdk_shim_mesh_sent_count-sent != BENCH_PACKETS) {
+    printf("requests haven't been answered\n");
+    bench_failures++;
+  }
+  if (sdk_shim_alloc_count != allocs) {  // The replies are built in buffers of the pool (cf. mesh_pool.c)
+    printf("replies have been allocated from the heap\n");
+    bench_failures++;
+  }
+
+  // Truncated packet (header->len exceeds the received length) and packet of
+  // another version of the mesh-header; both are dropped by the validation
+  bench_delta_build(&packet, bench_seq);
+  packet.len--;
+  drops = mesh_parser_drops_get(MESH_PARSER_DROP_HEADER);
+  bench_measure("truncated (rejected)", &packet, NULL, BENCH_PACKETS);
+  if (mesh_parser_drops_get(MESH_PARSER_DROP_HEADER)-drops != BENCH_PACKETS) {
+    printf("truncated packets haven't been counted\n");
+    bench_failures++;
+  }
+  packet.len++;
+  ((struct mesh_header_format *) packet.buf)->ver = ESP_MESH_VER+1;
+  drops = mesh_parser_drops_get(MESH_PARSER_DROP_VERSION);
+  bench_measure("version (rejected)", &packet, NULL, BENCH_PACKETS);
+  if (mesh_parser_drops_get(MESH_PARSER_DROP_VERSION)-drops != BENCH_PACKETS) {
+    printf("packets of another version haven't been counted\n");
+    bench_failures++;
+  }
+
+  // Empty packet, as handed over by mesh_task.c (without data); it is only
+  // counted, without any output in the receive-path
+  drops = mesh_parser_drops_get(MESH_PARSER_DROP_LENGTH);
+  prints = sdk_shim_printf_count;
+  mesh_packet_parser(&bench_conn, NULL, 0);
+  if (mesh_parser_drops_get(MESH_PARSER_DROP_LENGTH)-drops != 1 || sdk_shim_printf_count != prints) {
+    printf("empty packet hasn't been counted silently\n");
+    bench_failures++;
+  }
+
+  // Keep the seeds for the fuzzing
+  bench_snapshot_build(&bench_seeds[BENCH_SEED_SNAPSHOT], bench_seq+1);
+  bench_delta_build(&bench_seeds[BENCH_SEED_DELTA], bench_seq);
+  bench_request_build(&bench_seeds[BENCH_SEED_REQUEST]);
+}
+
+// Feed randomly mutated versions of the seeds into the parser
+static void bench_fuzz(void) {
+  struct bench_packet_type packet;
+  uint32_t idx = 0, rejected = 0, pos = 0, drops[MESH_PARSER_DROP_REASONS], dropped = 0;
+  uint8_t mutation = 0, mutations = 0, reason = 0;
+
+  // Only count the drops of the mutated packets (the previous measurements
+  // have dropped packets on purpose)
+  for (reason = 0; reason < MESH_PARSER_DROP_REASONS; reason++) {
+    drops[reason] = mesh_parser_drops_get(reason);
+  }
+
+  for (idx = 0; idx < BENCH_FUZZ_PACKETS; idx++) {
+    os_memcpy(&packet, &bench_seeds[bench_random()%BENCH_SEEDS], sizeof(struct bench_packet_type));
+    mutations = 1+bench_random()%BENCH_FUZZ_MUTATIONS;
+    for (mutation = 0; mutation < mutations; mutation++) {
+      pos = bench_random()%packet.len;
+      switch (bench_random()%4) {
+        case 0: // Flip a bit
+          packet.buf[pos] ^= 1 << (bench_random()%8);
+          break;
+        case 1: // Set a random byte
+          packet.buf[pos] = bench_random() & 0xFF;
+          break;
+        case 2: // Truncate the packet
+          packet.len = pos+1;
+          break;
+        default:  // Set a length-field (header->len, ot_len or the olen of the first option) to a random value
+          pos = bench_random()%3;
+          if (pos == 0) {
+            ((struct mesh_header_format *) packet.buf)->len = bench_random() & 0xFFFF;
+          }
+          else if (pos == 1) {
+            ((struct mesh_header_format *) packet.buf)->option[0].ot_len = bench_random() & 0xFFFF;
+          }
+          else {
+            packet.buf[ESP_MESH_HLEN+ESP_MESH_OT_LEN_LEN+1] = bench_random() & 0xFF;
+          }
+          break;
+      }
+    }
+    sdk_shim_mesh_root = (bench_random() & 0x0F) == 0;
+    if (!bench_fuzz_one(packet.buf, packet.len)) {
+      rejected++;
+    }
+    sdk_shim_time += 1000;
+  }
+  sdk_shim_mesh_root = false;
+  printf("\n%d mutated packets, %d rejected by the parser\n", BENCH_FUZZ_PACKETS, rejected);
+  for (reason = 0; reason < MESH_PARSER_DROP_REASONS; reason++) {
+    drops[reason] = mesh_parser_drops_get(reason)-drops[reason];
+    dropped += drops[reason];
+  }
+  printf("drops: length %d, version %d, header %d, protocol %d, options %d\n", drops[MESH_PARSER_DROP_LENGTH], drops[MESH_PARSER_DROP_VERSION], drops[MESH_PARSER_DROP_HEADER], drops[MESH_PARSER_DROP_PROTOCOL], drops[MESH_PARSER_DROP_OPTIONS]);
+  if (dropped > rejected) {
+    printf("more packets dropped than rejected\n");
+    bench_failures++;
+  }
+}
+
+// Replay the given file through LLVMFuzzerTestOneInput
+static bool bench_replay(const char *path) {
+  static uint8_t data[1+ESP_MESH_PKT_LEN_MAX];
+  size_t size = 0;
+  FILE *file = fopen(path, "rb");
+
+  if (!file) {
+    printf("%s: failed to open\n", path);
+    return false;
+  }
+  size = fread(data, 1, sizeof(data), file);
+  fclose(file);
+  LLVMFuzzerTestOneInput(data, size);
+  printf("%s: ok\n", path);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int idx = 0;
+
+  if (argc > 1) {
+    for (idx = 1; idx < argc; idx++) {
+      if (!bench_replay(argv[idx])) {
+        return EXIT_FAILURE;
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  bench_setup();
+  printf("mesh_parser benchmark (non-root-node, %d nodes per snapshot)\n\n", BENCH_SNAPSHOT_NODES);
+  bench_run();
+  bench_fuzz();
+
+  mesh_topology_disable();
+  if (bench_failures > 0) {
+    printf("%d checks FAILED\n", bench_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
+
+#endif
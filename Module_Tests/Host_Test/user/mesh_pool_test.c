@@ -0,0 +1,119 @@
+// mesh_pool_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the pool of packet-buffers (cf. mesh_pool.c).
+// Covers the choice of the buffer-size, the fallback to the larger buffers and
+// to the heap, the statistics (incl. the high-water-mark), rejecting the release
+// of buffers, that aren't acquired, as well as steady traffic without any heap-
+// allocation.
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define TEST_BUFFERS (MESH_POOL_SMALL_COUNT+MESH_POOL_LARGE_COUNT+1)
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+int main(void) {
+  uint16_t idx = 0;
+  uint32_t alloc_count = 0;
+  bool aligned = true;
+  uint8_t *small = NULL, *large = NULL, *heap = NULL, *bufs[TEST_BUFFERS];
+  struct mesh_pool_stats_type small_stats, large_stats;
+
+  // The smallest suitable buffer is chosen
+  alloc_count = sdk_shim_alloc_count;
+  small = (uint8_t *) mesh_pool_acquire(MESH_POOL_SMALL_SIZE);
+  large = (uint8_t *) mesh_pool_acquire(MESH_POOL_SMALL_SIZE+1);
+  mesh_pool_stats_get(MESH_POOL_SMALL, &small_stats);
+  mesh_pool_stats_get(MESH_POOL_LARGE, &large_stats);
+  test_check(small && large && sdk_shim_alloc_count == alloc_count, "buffers are taken from the pool");
+  test_check(small_stats.used == 1 && large_stats.used == 1 && small_stats.size >= MESH_POOL_SMALL_SIZE && large_stats.size >= ESP_MESH_PKT_LEN_MAX, "smallest suitable buffer is chosen");
+  test_check(small+MESH_POOL_SMALL_SIZE <= large || large+ESP_MESH_PKT_LEN_MAX <= small, "buffers don't overlap");
+  mesh_pool_release(small);
+  test_check(mesh_pool_acquire(1) == small, "released buffer is reused first");
+  mesh_pool_release(small);
+  mesh_pool_release(large);
+
+  // Oversized requests are served by the heap
+  heap = (uint8_t *) mesh_pool_acquire(ESP_MESH_PKT_LEN_MAX+1);
+  mesh_pool_stats_get(MESH_POOL_LARGE, &large_stats);
+  test_check(heap && sdk_shim_alloc_count == alloc_count+1 && large_stats.fallbacks == 1, "oversized buffer is allocated from the heap");
+  mesh_pool_release(heap);
+  test_check(sdk_shim_free_count == sdk_shim_alloc_count, "it is freed again");
+
+  // Exhausted small buffers fall back to the large ones and then to the heap
+  for (idx = 0; idx < TEST_BUFFERS; idx++) {
+    bufs[idx] = (uint8_t *) mesh_pool_acquire(1);
+    aligned &= ((uintptr_t) bufs[idx])%4 == 0;
+  }
+  mesh_pool_stats_get(MESH_POOL_SMALL, &small_stats);
+  mesh_pool_stats_get(MESH_POOL_LARGE, &large_stats);
+  test_check(small_stats.used == MESH_POOL_SMALL_COUNT && large_stats.used == MESH_POOL_LARGE_COUNT, "exhausted small buffers fall back to the large ones");
+  test_check(sdk_shim_alloc_count == alloc_count+2 && small_stats.fallbacks == 1, "exhausted pool falls back to the heap");
+  test_check(aligned, "buffers are aligned to 4 byte");
+  for (idx = 0; idx < TEST_BUFFERS; idx++) {
+    mesh_pool_release(bufs[idx]);
+  }
+  mesh_pool_stats_get(MESH_POOL_SMALL, &small_stats);
+  mesh_pool_stats_get(MESH_POOL_LARGE, &large_stats);
+  test_check(small_stats.used == 0 && large_stats.used == 0 && sdk_shim_free_count == sdk_shim_alloc_count, "all buffers are released");
+  test_check(small_stats.used_max == MESH_POOL_SMALL_COUNT && large_stats.used_max == MESH_POOL_LARGE_COUNT, "high-water-marks are kept");
+
+  // A buffer released twice doesn't corrupt the pool
+  small = (uint8_t *) mesh_pool_acquire(1);
+  mesh_pool_release(small);
+  mesh_pool_release(small);
+  mesh_pool_stats_get(MESH_POOL_SMALL, &small_stats);
+  test_check(small_stats.used == 0, "second release is rejected");
+
+  // A buffer released twice, while other buffers are in use, isn't handed out
+  // twice afterwards
+  small = (uint8_t *) mesh_pool_acquire(1);
+  bufs[0] = (uint8_t *) mesh_pool_acquire(1);
+  mesh_pool_release(small);
+  mesh_pool_release(small);
+  bufs[1] = (uint8_t *) mesh_pool_acquire(1);
+  bufs[2] = (uint8_t *) mesh_pool_acquire(1);
+  mesh_pool_stats_get(MESH_POOL_SMALL, &small_stats);
+  test_check(bufs[1] != bufs[2] && bufs[1] != bufs[0] && bufs[2] != bufs[0] && small_stats.used == 3, "double release with buffers in use is rejected");
+  mesh_pool_release(bufs[0]);
+  mesh_pool_release(bufs[1]);
+  mesh_pool_release(bufs[2]);
+  mesh_pool_release(bufs[2]+1);
+  mesh_pool_stats_get(MESH_POOL_SMALL, &small_stats);
+  test_check(small_stats.used == 0, "release of a pointer into a buffer is rejected");
+
+  // Steady traffic doesn't touch the heap
+  alloc_count = sdk_shim_alloc_count;
+  for (idx = 0; idx < 1000; idx++) {
+    small = (uint8_t *) mesh_pool_acquire(ESP_MESH_HLEN);
+    large = (uint8_t *) mesh_pool_acquire(ESP_MESH_PKT_LEN_MAX);
+    mesh_pool_release(large);
+    mesh_pool_release(small);
+  }
+  test_check(sdk_shim_alloc_count == alloc_count, "steady traffic doesn't allocate from the heap");
+
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
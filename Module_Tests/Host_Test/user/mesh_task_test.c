@@ -0,0 +1,153 @@
+// mesh_task_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the deferred processing of received packets
+// and timer-events (cf. mesh_task.c) against the simulated tasks of the SDK-
+// shim. Covers the order and the copying of the queued entries, the bound of
+// the queue and the entries reserved for events, the time-slicing of the task
+// as well as the release of pending entries.
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "user_interface.h"
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "mesh_task.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+#define TEST_LOG_LEN 64
+
+static uint8_t test_log[TEST_LOG_LEN];  // First byte of the data of every processed entry (0xFF for an event)
+static uint8_t test_log_count = 0;
+static uint32_t test_duration = 0;      // Simulated duration of every processed entry (in us)
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+// Handler-function, that records the processed entries
+static void test_handler(void *arg, uint8_t *data, uint16_t len) {
+  if (test_log_count < TEST_LOG_LEN) {
+    test_log[test_log_count++] = data ? data[0] : 0xFF;
+  }
+  sdk_shim_time += test_duration;
+}
+
+// Handler-function, that queues an event from within the task
+static void test_handler_post(void *arg, uint8_t *data, uint16_t len) {
+  test_handler(arg, data, len);
+  mesh_task_post(test_handler, NULL, NULL, 0);
+}
+
+// Queue a packet, whose first byte is the given value
+static bool test_post(uint8_t value) {
+  uint8_t packet[ESP_MESH_HLEN] = {0};
+
+  packet[0] = value;
+  return mesh_task_post(test_handler, NULL, packet, sizeof(packet));
+}
+
+// Run the task until there are no more events; return the number of runs
+static uint16_t test_run(void) {
+  uint16_t runs = 0;
+
+  while (sdk_shim_task_posts > 0) {
+    sdk_shim_task_run();
+    runs++;
+  }
+  test_log_count = 0;
+  return runs;
+}
+
+int main(void) {
+  uint8_t idx = 0, packet[ESP_MESH_PKT_LEN_MAX+1];
+  uint32_t alloc_count = 0;
+  bool ordered = true, posted = true;
+  struct mesh_task_stats_type stats;
+  struct mesh_pool_stats_type pool_stats;
+
+  sdk_shim_time = 1000000;
+
+  test_check(!test_post(0), "packet isn't queued before the initialization");
+  test_check(mesh_task_init() && mesh_task_init(), "task is registered once");
+
+  // The entries are processed in their order by a single run
+  alloc_count = sdk_shim_alloc_count;
+  test_post(1);
+  test_post(2);
+  mesh_task_post(test_handler, NULL, NULL, 0);
+  test_check(sdk_shim_task_posts == 1 && test_log_count == 0, "entries are queued and the task is posted once");
+  sdk_shim_task_run();
+  test_check(test_log_count == 3 && test_log[0] == 1 && test_log[1] == 2 && test_log[2] == 0xFF, "entries are processed in their order");
+  mesh_pool_stats_get(MESH_POOL_SMALL, &pool_stats);
+  test_check(sdk_shim_task_posts == 0 && pool_stats.acquired == 2 && pool_stats.used == 0 && sdk_shim_alloc_count == alloc_count, "copies of the packets are released to the pool");
+  test_run();
+
+  // Packets can't occupy the entries reserved for events
+  for (idx = 0; idx < MESH_TASK_QUEUE_LEN-MESH_TASK_QUEUE_RESERVED; idx++) {
+    posted &= test_post(idx);
+  }
+  test_check(posted && !test_post(0), "queue is bounded for packets");
+  for (idx = 0; idx < MESH_TASK_QUEUE_RESERVED; idx++) {
+    posted &= mesh_task_post(test_handler, NULL, NULL, 0);
+  }
+  test_check(posted && !mesh_task_post(test_handler, NULL, NULL, 0), "events use the reserved entries");
+  mesh_task_stats_get(&stats);
+  test_check(stats.dropped == 2 && stats.pending_max == MESH_TASK_QUEUE_LEN, "dropped entries are counted");
+  sdk_shim_task_run();
+  for (idx = 0; idx < MESH_TASK_QUEUE_LEN-MESH_TASK_QUEUE_RESERVED; idx++) {
+    ordered &= test_log[idx] == idx;
+  }
+  test_check(test_log_count == MESH_TASK_QUEUE_LEN && ordered, "full queue is processed in its order");
+  test_run();
+
+  os_memset(packet, 0, sizeof(packet));
+  test_check(!mesh_task_post(test_handler, NULL, packet, sizeof(packet)), "oversized packet is dropped");
+
+  // A run of the task yields after MESH_TASK_SLICE
+  test_duration = MESH_TASK_SLICE/2;
+  for (idx = 0; idx < 6; idx++) {
+    test_post(idx);
+  }
+  sdk_shim_task_run();
+  test_check(test_log_count == 2 && sdk_shim_task_posts == 1, "run yields after its time-slice");
+  test_check(test_run() == 2, "remaining entries are processed by the next runs");
+  test_duration = MESH_TASK_SLICE*2;
+  test_post(0);
+  test_post(1);
+  sdk_shim_task_run();
+  test_check(test_log_count == 1, "long entry is processed alone");
+  test_run();
+  test_duration = 0;
+
+  // The handler-function can queue further entries
+  mesh_task_post(test_handler_post, NULL, NULL, 0);
+  test_check(test_run() == 2, "entry queued by the handler is processed");
+
+  // Pending entries are dropped
+  test_post(0);
+  test_post(1);
+  mesh_task_release();
+  sdk_shim_task_run();
+  mesh_pool_stats_get(MESH_POOL_SMALL, &pool_stats);
+  test_check(test_log_count == 0 && pool_stats.used == 0 && sdk_shim_alloc_count == sdk_shim_free_count, "release drops the pending entries");
+  test_check(test_post(2) && test_run() == 1, "queue is usable after the release");
+
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+// mesh_tx_test.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Host-side test of the transmit-queue (cf. mesh_tx.c) against the
+// simulated mesh-API and timers of the SDK-shim. Covers the queueing and
+// retrying of packets after temporary errors (incl. the backoff and the
+// congestion-flags), the bound of the queue, dropping packets after permanent
+// errors or too many attempts as well as pausing the transmission on request
+// of the parent-node.
+
+#include <stdlib.h>
+#include "mem.h"
+#include "osapi.h"
+#include "espconn.h"
+#include "mesh.h"
+#include "mesh_codec.h"
+#include "mesh_tx.h"
+#include "sdk_shim.h"
+#include "user_config.h"
+
+static struct espconn test_conn;
+static uint8_t test_src[ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x00, 0x01};
+static uint8_t test_parent[ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x20, 0x00};  // Station-MAC-address of the parent-node
+static uint8_t test_other[ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x30, 0x00};   // Any other node
+
+static uint16_t test_failures = 0;
+
+// Report the result of a single check
+static void test_check(bool condition, const char *description) {
+  printf("%-60s %s\n", description, condition ? "ok" : "FAILED");
+  if (!condition) {
+    test_failures++;
+  }
+}
+
+// Send a packet, whose destination-address ends with the given index
+static bool test_send(uint8_t idx) {
+  uint8_t buf[ESP_MESH_HLEN], dst[ESP_MESH_ADDR_LEN] = {0x18, 0xfe, 0x34, 0x00, 0x01, 0x00};
+
+  dst[5] = idx;
+  mesh_codec_packet_init(buf, sizeof(buf), dst, test_src, true, false, true, M_PROTO_NONE, false);
+  return mesh_tx_send(&test_conn, buf, sizeof(buf));
+}
+
+// Pass a packet from the given source-address with the given direction and
+// congestion-flags to the queue
+static void test_congest(const uint8_t *src, bool upwards, bool cr, bool cp) {
+  struct mesh_header_format header;
+
+  os_memset(&header, 0, sizeof(header));
+  os_memcpy(header.src_addr, src, ESP_MESH_ADDR_LEN);
+  header.proto.d = upwards;
+  header.cr = cr;
+  header.cp = cp;
+  mesh_tx_congest_handle(&header);
+}
+
+// Advance the system-time by the given duration (in ms) and run the expired
+// timers
+static void test_wait(uint32_t time) {
+  sdk_shim_time += time*1000;
+  sdk_shim_timers_run();
+}
+
+int main(void) {
+  uint8_t idx = 0;
+  uint16_t waits = 0;
+  uint32_t sent = 0;
+  bool queued = true;
+  struct mesh_tx_stats_type stats;
+
+  sdk_shim_time = 1000000;
+
+  test_check(test_send(0) && sdk_shim_mesh_sent_count == 1, "packet is sent directly without queue");
+  test_check(mesh_tx_init(), "queue is initialized");
+  test_check(test_send(1) && sdk_shim_mesh_sent_count == 2, "packet is sent right away");
+
+  // Temporary errors: the packets are queued and retried with a backoff
+  sdk_shim_mesh_sent_result = ESPCONN_MAXNUM;
+  test_check(test_send(2) && test_send(3) && test_send(4), "packets are queued after a temporary error");
+  mesh_tx_stats_get(&stats);
+  test_check(stats.queued == 3 && stats.depth == 3 && sdk_shim_mesh_sent_count == 2, "queued packets aren't sent yet");
+  test_wait(MESH_TX_RETRY_INTERVAL);
+  mesh_tx_stats_get(&stats);
+  test_check(stats.retries == 1, "first packet is retried after the interval");
+  test_wait(MESH_TX_RETRY_INTERVAL);
+  mesh_tx_stats_get(&stats);
+  test_check(stats.retries == 1, "next retry waits for the doubled interval");
+  test_wait(MESH_TX_RETRY_INTERVAL);
+  mesh_tx_stats_get(&stats);
+  test_check(stats.retries == 2, "packet is retried after the doubled interval");
+  sdk_shim_mesh_sent_result = ESPCONN_OK;
+  test_wait(4*MESH_TX_RETRY_INTERVAL);
+  mesh_tx_stats_get(&stats);
+  test_check(sdk_shim_mesh_sent_count == 5 && stats.depth == 0 && sdk_shim_mesh_sent_header.dst_addr[5] == 4, "queued packets are sent in their order");
+  test_check(!sdk_shim_mesh_sent_header.cr && sdk_shim_mesh_release_count == 1, "congestion is released after the queue drained");
+
+  // The queue is bounded and packets are dropped after too many attempts
+  sdk_shim_mesh_sent_result = ESPCONN_MEM;
+  for (idx = 0; idx < MESH_TX_QUEUE_LEN; idx++) {
+    queued &= test_send(idx);
+  }
+  test_check(queued && !test_send(0), "queue is bounded");
+  mesh_tx_stats_get(&stats);
+  test_check(stats.dropped == 1 && stats.depth == MESH_TX_QUEUE_LEN && stats.depth_max == MESH_TX_QUEUE_LEN, "depth of the queue and drops are reported");
+  while (stats.depth > 0 && waits++ < 1000) {
+    test_wait(MESH_TX_RETRY_INTERVAL_MAX);
+    mesh_tx_stats_get(&stats);
+  }
+  test_check(stats.depth == 0 && stats.dropped == MESH_TX_QUEUE_LEN+1, "packets are dropped after too many attempts");
+  test_check(stats.retries == 2+MESH_TX_QUEUE_LEN*(MESH_TX_RETRY_MAX-1)-1, "every packet is attempted MESH_TX_RETRY_MAX times");
+
+  // Permanent errors aren't retried
+  sdk_shim_mesh_sent_result = ESPCONN_ARG;
+  test_check(!test_send(0), "packet is dropped after a permanent error");
+  sdk_shim_mesh_sent_result = ESPCONN_OK;
+
+  // Congestion-request and -permit of the parent-node (the SDK returns its
+  // softAP-MAC-address)
+  os_memcpy(sdk_shim_mesh_parent, test_parent, ESP_MESH_ADDR_LEN);
+  sdk_shim_mesh_parent[0] |= 0x02;
+  sdk_shim_mesh_parent_known = true;
+  sent = sdk_shim_mesh_sent_count;
+  test_congest(test_other, false, true, false);
+  test_check(test_send(5) && sdk_shim_mesh_sent_count == sent+1, "congestion-request of another node is ignored");
+  sent = sdk_shim_mesh_sent_count;
+  test_congest(test_parent, false, true, false);
+  test_check(test_send(5) && sdk_shim_mesh_sent_count == sent, "congestion-request of the parent pauses the transmission");
+  test_congest(test_parent, true, false, true);
+  test_check(sdk_shim_mesh_sent_count == sent, "permit of an upward packet is ignored");
+  test_congest(test_parent, false, false, true);
+  test_check(sdk_shim_mesh_sent_count == sent+1, "congestion-permit resumes the transmission");
+  test_congest(test_parent, false, true, false);
+  test_send(6);
+  test_wait(MESH_TX_PAUSE_TIMEOUT);
+  test_check(sdk_shim_mesh_sent_count == sent+2, "transmission is resumed after the timeout");
+  test_congest(test_parent, true, true, false);
+  test_check(test_send(7) && sdk_shim_mesh_sent_count == sent+3, "congestion-request of an upward packet is ignored");
+  sdk_shim_mesh_parent_known = false;
+  test_congest(test_parent, false, true, false);
+  test_check(test_send(8) && sdk_shim_mesh_sent_count == sent+4, "congestion-request without a parent is ignored");
+  mesh_tx_stats_get(&stats);
+  test_check(stats.pauses == 2, "pauses are counted");
+
+  // Pending packets are dropped
+  sdk_shim_mesh_sent_result = ESPCONN_MAXNUM;
+  test_send(9);
+  mesh_tx_release();
+  sdk_shim_mesh_sent_result = ESPCONN_OK;
+  test_wait(MESH_TX_RETRY_INTERVAL_MAX);
+  test_check(sdk_shim_mesh_sent_count == sent+4 && sdk_shim_alloc_count == sdk_shim_free_count, "release drops the queued packets");
+
+  if (test_failures > 0) {
+    printf("%d checks FAILED\n", test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
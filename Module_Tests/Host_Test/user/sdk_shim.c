@@ -0,0 +1,347 @@
+// sdk_shim.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: This class provides host-side implementations of the SDK-
+// functions used by the mesh-modules, so that they can be compiled, tested and
+// benchmarked on a Linux-host. Heap-allocations are counted and the system-time
+// is a virtual clock, which is controlled by the test itself. The flash is
+// simulated in RAM with the semantics of NOR-flash (writing can only clear
+// bits; erasing sets a whole sector to 0xFF). The tasks (cf. system_os_task)
+// and the expired timers are only run on request of the test (cf.
+// sdk_shim_task_run and sdk_shim_timers_run). The mesh-API only simulates a
+// single, isolated node: packets are counted (and passed on to the test, cf.
+// sdk_shim_mesh_sent_handler) instead of being sent.
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mem.h"
+#include "osapi.h"
+#include "user_interface.h"
+#include "spi_flash.h"
+#include "mesh.h"
+#include "esp_mesh.h"
+#include "sdk_shim.h"
+
+uint32 sdk_shim_alloc_count = 0;
+uint32 sdk_shim_free_count = 0;
+uint32 sdk_shim_time = 0;
+bool sdk_shim_verbose = false;
+uint32 sdk_shim_printf_count = 0;
+
+uint8 sdk_shim_flash[SDK_SHIM_FLASH_SECTORS*SPI_FLASH_SEC_SIZE];
+uint32 sdk_shim_flash_erase_count = 0;
+sint32 sdk_shim_flash_write_limit = -1;
+
+uint32 sdk_shim_task_posts = 0;
+
+bool sdk_shim_mesh_root = false;
+uint8 sdk_shim_mesh_status = MESH_ONLINE_AVAIL;
+uint8 sdk_shim_mesh_parent[ESP_MESH_ADDR_LEN];
+bool sdk_shim_mesh_parent_known = false;
+uint8 *sdk_shim_mesh_nodes = NULL;
+uint16 sdk_shim_mesh_node_count = 0;
+uint32 sdk_shim_mesh_sent_count = 0;
+sint8 sdk_shim_mesh_sent_result = ESPCONN_OK;
+struct mesh_header_format sdk_shim_mesh_sent_header;
+void (*sdk_shim_mesh_sent_handler)(uint8 *pdata, uint16 len) = NULL;
+uint32 sdk_shim_mesh_release_count = 0;
+
+static os_timer_t *sdk_shim_timers = NULL; // List of the armed timers
+
+// Return a monotonic timestamp of the host (in ns) to measure durations
+uint64_t sdk_shim_clock_ns(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec*1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+/*------------------------------------*/
+
+// mem.h:
+
+void *os_zalloc(size_t size) {
+  sdk_shim_alloc_count++;
+  return calloc(1, size);
+}
+
+void *os_malloc(size_t size) {
+  sdk_shim_alloc_count++;
+  return malloc(size);
+}
+
+void os_free(void *ptr) {
+  if (ptr) {
+    sdk_shim_free_count++;
+  }
+  free(ptr);
+}
+
+/*------------------------------------*/
+
+// osapi.h:
+
+int os_printf(const char *format, ...) {
+  int len = 0;
+  va_list args;
+
+  sdk_shim_printf_count++;
+  if (!sdk_shim_verbose) {
+    return 0;
+  }
+  va_start(args, format);
+  len = vprintf(format, args);
+  va_end(args);
+  return len;
+}
+
+// Remove the given timer from the list of the armed timers
+static void sdk_shim_timer_remove(os_timer_t *timer) {
+  os_timer_t **entry = &sdk_shim_timers;
+
+  while (*entry) {
+    if (*entry == timer) {
+      *entry = timer->timer_next;
+      break;
+    }
+    entry = &(*entry)->timer_next;
+  }
+  timer->timer_next = NULL;
+}
+
+void os_timer_disarm(os_timer_t *timer) {
+  sdk_shim_timer_remove(timer);
+  timer->timer_period = 0;
+}
+
+void os_timer_setfn(os_timer_t *timer, os_timer_func_t *func, void *arg) {
+  timer->timer_func = func;
+  timer->timer_arg = arg;
+}
+
+void os_timer_arm(os_timer_t *timer, uint32 time, bool repeat) {
+  sdk_shim_timer_remove(timer);
+  timer->timer_expire = sdk_shim_time + time*1000;
+  timer->timer_period = repeat ? time : 0;
+  timer->timer_next = sdk_shim_timers;
+  sdk_shim_timers = timer;
+}
+
+// Run the timer-functions of all timers, which have expired at the current
+// system-time (a periodical timer is re-armed first); return their number
+uint32 sdk_shim_timers_run(void) {
+  os_timer_t *timer = NULL;
+  uint32 count = 0;
+  bool expired = true;
+
+  while (expired) {
+    expired = false;
+    for (timer = sdk_shim_timers; timer; timer = timer->timer_next) {
+      if ((sint32) (sdk_shim_time-timer->timer_expire) >= 0) {
+        if (timer->timer_period > 0) {
+          os_timer_arm(timer, timer->timer_period, true);
+        }
+        else {
+          sdk_shim_timer_remove(timer);
+        }
+        timer->timer_func(timer->timer_arg);
+        count++;
+        expired = true;
+        break;  // The list may have been changed by the timer-function
+      }
+    }
+  }
+  return count;
+}
+
+/*------------------------------------*/
+
+// user_interface.h:
+
+uint32 system_get_time(void) {
+  return sdk_shim_time;
+}
+
+uint32 system_get_free_heap_size(void) {
+  return 40*1024;
+}
+
+// Registered tasks with the events posted to them (in their order)
+static struct {
+  os_task_t task;
+  os_event_t *queue;
+  uint8 qlen;
+  uint8 count;
+} sdk_shim_tasks[USER_TASK_PRIO_MAX];
+
+bool system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen) {
+  if (!task || prio >= USER_TASK_PRIO_MAX || !queue || qlen == 0 || sdk_shim_tasks[prio].task) {
+    return false;
+  }
+  sdk_shim_tasks[prio].task = task;
+  sdk_shim_tasks[prio].queue = queue;
+  sdk_shim_tasks[prio].qlen = qlen;
+  sdk_shim_tasks[prio].count = 0;
+  return true;
+}
+
+bool system_os_post(uint8 prio, os_signal_t sig, os_param_t par) {
+  if (prio >= USER_TASK_PRIO_MAX || !sdk_shim_tasks[prio].task || sdk_shim_tasks[prio].count >= sdk_shim_tasks[prio].qlen) {
+    return false;
+  }
+  sdk_shim_tasks[prio].queue[sdk_shim_tasks[prio].count].sig = sig;
+  sdk_shim_tasks[prio].queue[sdk_shim_tasks[prio].count].par = par;
+  sdk_shim_tasks[prio].count++;
+  sdk_shim_task_posts++;
+  return true;
+}
+
+// Deliver the next posted event to its task (the one of the highest priority
+// first, like the SDK does); return the number of events still pending
+uint32 sdk_shim_task_run(void) {
+  os_event_t event;
+  sint8 prio = 0;
+
+  for (prio = USER_TASK_PRIO_MAX-1; prio >= 0; prio--) {
+    if (sdk_shim_tasks[prio].count > 0) {
+      event = sdk_shim_tasks[prio].queue[0];
+      os_memmove(sdk_shim_tasks[prio].queue, &sdk_shim_tasks[prio].queue[1], (sdk_shim_tasks[prio].count-1)*sizeof(os_event_t));
+      sdk_shim_tasks[prio].count--;
+      sdk_shim_task_posts--;
+      sdk_shim_tasks[prio].task(&event);
+      break;
+    }
+  }
+  return sdk_shim_task_posts;
+}
+
+uint8 wifi_get_opmode(void) {
+  return STATIONAP_MODE;
+}
+
+bool wifi_get_macaddr(uint8 if_index, uint8 *macaddr) {
+  uint8 mac[6] = {0x18, 0xfe, 0x34, 0x00, 0x00, 0x01};
+
+  os_memcpy(macaddr, mac, sizeof(mac));
+  macaddr[5] += if_index;
+  return true;
+}
+
+/*------------------------------------*/
+
+// spi_flash.h:
+
+// Erase the whole simulated flash and reset its counters
+void sdk_shim_flash_reset(void) {
+  os_memset(sdk_shim_flash, 0xFF, sizeof(sdk_shim_flash));
+  sdk_shim_flash_erase_count = 0;
+  sdk_shim_flash_write_limit = -1;
+}
+
+// Check, that the given range lies within the simulated flash and is aligned to
+// 4 bytes (like the SDK requires it)
+static bool sdk_shim_flash_range(uint32 addr, uint32 *buf, uint32 size) {
+  return addr%4 == 0 && (uintptr_t) buf%4 == 0 && size%4 == 0 && addr+size <= sizeof(sdk_shim_flash);
+}
+
+SpiFlashOpResult spi_flash_erase_sector(uint16 sec) {
+  if (sec >= SDK_SHIM_FLASH_SECTORS || sdk_shim_flash_write_limit == 0) {
+    return SPI_FLASH_RESULT_ERR;
+  }
+  sdk_shim_flash_erase_count++;
+  os_memset(&sdk_shim_flash[sec*SPI_FLASH_SEC_SIZE], 0xFF, SPI_FLASH_SEC_SIZE);
+  return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_write(uint32 des_addr, uint32 *src_addr, uint32 size) {
+  uint8 *src = (uint8 *) src_addr;
+  uint32 idx = 0;
+
+  if (!sdk_shim_flash_range(des_addr, src_addr, size)) {
+    return SPI_FLASH_RESULT_ERR;
+  }
+  for (idx = 0; idx < size; idx++) {
+    if (sdk_shim_flash_write_limit == 0) {  // Power-loss; the rest isn't written
+      return SPI_FLASH_RESULT_ERR;
+    }
+    if (sdk_shim_flash_write_limit > 0) {
+      sdk_shim_flash_write_limit--;
+    }
+    sdk_shim_flash[des_addr+idx] &= src[idx];
+  }
+  return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_read(uint32 src_addr, uint32 *des_addr, uint32 size) {
+  if (!sdk_shim_flash_range(src_addr, des_addr, size)) {
+    return SPI_FLASH_RESULT_ERR;
+  }
+  os_memcpy(des_addr, &sdk_shim_flash[src_addr], size);
+  return SPI_FLASH_RESULT_OK;
+}
+
+// Normally provided by the application (cf. esp_mesh.c)
+uint32 user_rf_cal_sector_set(void) {
+  return SDK_SHIM_FLASH_SECTORS-5;
+}
+
+/*------------------------------------*/
+
+// mesh.h:
+
+bool espconn_mesh_is_root() {
+  return sdk_shim_mesh_root;
+}
+
+sint8 espconn_mesh_get_status() {
+  return sdk_shim_mesh_status;
+}
+
+// The simulated node has no child-nodes; it only has sub-nodes and a parent-
+// node, if the test has set them (cf. sdk_shim_mesh_nodes and
+// sdk_shim_mesh_parent)
+bool espconn_mesh_get_node_info(enum mesh_node_type type, uint8_t **info, uint16_t *count) {
+  if (!info || !count) {  // Release the information
+    return true;
+  }
+  if (type == MESH_NODE_PARENT && sdk_shim_mesh_parent_known) {
+    *info = sdk_shim_mesh_parent;
+    *count = 1;
+    return true;
+  }
+  if (type == MESH_NODE_ALL && sdk_shim_mesh_nodes) {
+    *info = sdk_shim_mesh_nodes;
+    *count = sdk_shim_mesh_node_count;
+    return true;
+  }
+  *info = NULL;
+  *count = 0;
+  return false;
+}
+
+// Fails with sdk_shim_mesh_sent_result, if it isn't ESPCONN_OK
+sint8 espconn_mesh_sent(struct espconn *usr_esp, uint8 *pdata, uint16 len) {
+  if (!usr_esp || !pdata || len < ESP_MESH_HLEN) {
+    return ESPCONN_ARG;
+  }
+  if (sdk_shim_mesh_sent_result != ESPCONN_OK) {
+    return sdk_shim_mesh_sent_result;
+  }
+  sdk_shim_mesh_sent_count++;
+  os_memcpy(&sdk_shim_mesh_sent_header, pdata, ESP_MESH_HLEN);
+  if (sdk_shim_mesh_sent_handler) {
+    sdk_shim_mesh_sent_handler(pdata, len);
+  }
+  return ESPCONN_OK;
+}
+
+void espconn_mesh_release_congest() {
+  sdk_shim_mesh_release_count++;
+}
+
+// Normally provided by the application (cf. esp_mesh.c)
+struct espconn *esp_mesh_conn = NULL;
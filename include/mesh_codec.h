@@ -0,0 +1,170 @@
+// mesh_codec.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: Portable implementation of the packet-format of the mesh (cf.
+// struct mesh_header_format and the format of the option-elements in mesh.h),
+// which replaces the header-accessors of the closed libmesh.a on the receive-
+// and transmit-path. All functions are inline and check the bounds of the
+// packet, so that they can be inlined into the parser and compiled on a Linux-
+// host for tests and benchmarks as well.
+//
+// The option-list starts with its total length (ot_len, including the length-
+// field itself) and is followed by the user-data; header->len is the total
+// length of the packet (including the mesh-header).
+
+#ifndef __MESH_CODEC_H__
+#define __MESH_CODEC_H__
+
+#include "c_types.h"
+#include "osapi.h"
+#include "mesh.h"
+
+/*------------ functions -------------*/
+
+// Check the given packet of the given (received) length: the mesh-header, the
+// length-field of the option-list (if any) and the option-list itself have to
+// fit into the packet; the options themselves are checked by
+// mesh_codec_option_next
+static inline bool mesh_codec_header_check(const struct mesh_header_format *header, uint16_t len) {
+  if (!header || len < ESP_MESH_HLEN || header->len < ESP_MESH_HLEN || header->len > len) {
+    return false;
+  }
+  if (header->oe) {
+    if (header->len < ESP_MESH_HLEN+ESP_MESH_OT_LEN_LEN || header->option[0].ot_len < ESP_MESH_OT_LEN_LEN || header->option[0].ot_len > header->len-ESP_MESH_HLEN) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Return the communication-protocol of the user-data (cf. enum
+// mesh_usr_proto_type)
+static inline uint8_t mesh_codec_proto_get(const struct mesh_header_format *header) {
+  return header->proto.protocol;
+}
+
+// Return the total length of the option-list (0, if the packet doesn't carry
+// any options)
+static inline uint16_t mesh_codec_ot_len_get(const struct mesh_header_format *header) {
+  return header->oe ? header->option[0].ot_len : 0;
+}
+
+// Determine the user-data of the given (checked) packet, which follows the
+// option-list; return false, if the packet doesn't contain any
+static inline bool mesh_codec_usr_data_get(struct mesh_header_format *header, uint8_t **usr_data, uint16_t *usr_data_len) {
+  uint16_t offset = ESP_MESH_HLEN+mesh_codec_ot_len_get(header);
+
+  if (header->len <= offset) {
+    return false;
+  }
+  *usr_data = (uint8_t *) header+offset;
+  *usr_data_len = header->len-offset;
+  return true;
+}
+
+// Return the option at the given offset (relative to the start of the option-
+// list; 0 = first option) of the given (checked) packet and advance the offset
+// to the next one; NULL is returned at the end of the list as well as for an
+// option exceeding it (in which case the offset stays in front of it, cf.
+// mesh_codec_options_end)
+static inline struct mesh_header_option_format *mesh_codec_option_next(struct mesh_header_format *header, uint16_t *offset) {
+  uint16_t end = mesh_codec_ot_len_get(header);
+  struct mesh_header_option_format *option = NULL;
+
+  if (end < ESP_MESH_OT_LEN_LEN) {
+    return NULL;
+  }
+  end -= ESP_MESH_OT_LEN_LEN;
+  if (*offset+ESP_MESH_OPTION_HLEN > end) {
+    return NULL;
+  }
+  option = (struct mesh_header_option_format *) ((uint8_t *) header->option[0].olist+*offset);
+  if (*offset+ESP_MESH_OPTION_HLEN+option->olen > end) {
+    return NULL;
+  }
+  *offset += ESP_MESH_OPTION_HLEN+option->olen;
+  return option;
+}
+
+// Check, whether the given offset (cf. mesh_codec_option_next) has reached the
+// end of the option-list, i.e. all options have been read without exceeding it
+static inline bool mesh_codec_options_end(const struct mesh_header_format *header, uint16_t offset) {
+  return offset+ESP_MESH_OT_LEN_LEN == mesh_codec_ot_len_get(header) || (offset == 0 && !header->oe);
+}
+
+// Return the idx-th option (starting with 1) of the given type of the given
+// (checked) packet or NULL, if there is none
+static inline struct mesh_header_option_format *mesh_codec_option_find(struct mesh_header_format *header, uint8_t otype, uint16_t idx) {
+  uint16_t offset = 0;
+  struct mesh_header_option_format *option = NULL;
+
+  while ((option = mesh_codec_option_next(header, &offset))) {
+    if (option->otype == otype && --idx == 0) {
+      return option;
+    }
+  }
+  return NULL;
+}
+
+// Initialize a packet from the given source- to the given destination-address
+// in the given buffer of the given size; the packet is empty and grows with
+// every option (cf. mesh_codec_option_append) and the user-data (cf.
+// mesh_codec_usr_data_set) added afterwards. Unlike espconn_mesh_create_packet,
+// the buffer is provided by the caller, and the direction of the flow (upwards
+// to the root or downwards to the sub-nodes) is set explicitly.
+static inline bool mesh_codec_packet_init(uint8_t *buf, uint16_t size, const uint8_t *dst_addr, const uint8_t *src_addr, bool p2p, bool piggyback_cr, bool upwards, uint8_t proto, bool option) {
+  struct mesh_header_format *header = (struct mesh_header_format *) buf;
+
+  if (!buf || size < ESP_MESH_HLEN+(option ? ESP_MESH_OT_LEN_LEN : 0)) {
+    return false;
+  }
+  os_memset(buf, 0, ESP_MESH_HLEN);
+  header->ver = ESP_MESH_VER;
+  header->oe = option;
+  header->cr = piggyback_cr;
+  header->proto.d = upwards;
+  header->proto.p2p = p2p;
+  header->proto.protocol = proto;
+  os_memcpy(header->dst_addr, dst_addr, ESP_MESH_ADDR_LEN);
+  os_memcpy(header->src_addr, src_addr, ESP_MESH_ADDR_LEN);
+  header->len = ESP_MESH_HLEN;
+  if (option) {
+    header->option[0].ot_len = ESP_MESH_OT_LEN_LEN;
+    header->len += ESP_MESH_OT_LEN_LEN;
+  }
+  return true;
+}
+
+// Append an option with the given type and value to the option-list of the
+// given packet (initialized by mesh_codec_packet_init with options and without
+// user-data yet), which is stored in a buffer of the given size
+static inline bool mesh_codec_option_append(struct mesh_header_format *header, uint16_t size, uint8_t otype, const uint8_t *ovalue, uint8_t olen) {
+  struct mesh_header_option_format *option = NULL;
+
+  if (!header->oe || header->len != ESP_MESH_HLEN+header->option[0].ot_len || header->len+ESP_MESH_OPTION_HLEN+olen > size) {
+    return false;
+  }
+  option = (struct mesh_header_option_format *) ((uint8_t *) header+header->len);
+  option->otype = otype;
+  option->olen = olen;
+  os_memcpy(option->ovalue, ovalue, olen);
+  header->option[0].ot_len += ESP_MESH_OPTION_HLEN+olen;
+  header->len += ESP_MESH_OPTION_HLEN+olen;
+  return true;
+}
+
+// Append the given user-data to the given packet (after all options have been
+// added), which is stored in a buffer of the given size
+static inline bool mesh_codec_usr_data_set(struct mesh_header_format *header, uint16_t size, const uint8_t *usr_data, uint16_t usr_data_len) {
+  if (header->len != ESP_MESH_HLEN+mesh_codec_ot_len_get(header) || header->len+usr_data_len > size) {
+    return false;
+  }
+  os_memcpy((uint8_t *) header+header->len, usr_data, usr_data_len);
+  header->len += usr_data_len;
+  return true;
+}
+
+#endif
@@ -8,8 +8,23 @@
 #define __MESH_DEVICE_H__
 
 #include "c_types.h"
+#include "user_config.h"
 
-/*------------- structs --------------*/
+/*------------- defines --------------*/
+
+#define MESH_DEVICE_WHEEL_SLOTS 8 // Number of buckets of the timing-wheel, which orders the registered nodes by their expiry-deadline (power of two)
+#define MESH_DEVICE_OUI_SLOTS 4   // Number of entries of the OUI-dictionary (only used if MESH_DEVICE_OUI_COMPRESSION is enabled)
+#define MESH_DEVICE_DEPTH_UNKNOWN 0xFF  // Depth of a node, whose path to the root isn't known (completely)
+
+/*-------- structs and types ---------*/
+
+#if MESH_DEVICE_OUI_COMPRESSION
+typedef uint32_t mesh_device_key_type;  // NIC-specific part of the MAC-address and the index of its OUI in the OUI-dictionary packed into an integer (cf. mesh_device_key)
+typedef uint16_t mesh_device_time_type; // Coarse timestamp on the registry's monotonic clock (in s)
+#else
+typedef uint64_t mesh_device_key_type;  // MAC-address packed into an integer (cf. mesh_device_key)
+typedef uint32_t mesh_device_time_type; // System-time (in us)
+#endif
 
 struct mesh_device_mac_type {
     uint8_t mac[6];
@@ -20,10 +35,67 @@ struct mesh_device_node_type {
     uint32_t timestamp;
 } __packed;
 
+struct mesh_device_oui_type {
+    uint8_t oui[3];         // Vendor-specific part of the MAC-address
+    uint16_t refs;          // Number of registered nodes (incl. the root) with this OUI; 0 = free entry
+} __packed;
+
+struct mesh_device_wheel_link_type {
+    uint16_t next;          // Position of the next node in the same bucket of the timing-wheel
+    uint16_t prev;          // Position of the previous node in the same bucket of the timing-wheel
+    uint8_t bucket;         // Bucket of the timing-wheel, that the node is linked into
+} __packed;
+
+struct mesh_device_tree_type {
+    uint16_t parent;        // Position of the parent-node (MESH_DEVICE_INDEX_ROOT = root, MESH_DEVICE_INDEX_NONE = not known)
+    uint16_t child;         // Position of the first child-node
+    uint16_t sibling;       // Position of the next child-node of the same parent
+    uint16_t size;          // Number of nodes in the subtree (including the node itself)
+    uint8_t depth;          // Mesh-layer of the node relative to the root (root = 0)
+};  // Not packed, since the links are referenced by pointers
+
 struct mesh_device_list_type {
     uint16_t entries_count; // Entry 1 = root, entries 2..n = registered nodes
     struct mesh_device_node_type root;
-    struct mesh_device_node_type *list;
+    mesh_device_key_type root_key;  // Packed MAC-address of the root
+    mesh_device_key_type *keys;     // Packed MAC-addresses of the registered nodes (node-pool, which is allocated once with the maximum capacity)
+    mesh_device_time_type *timestamps;  // Timestamps of the registered nodes (parallel to keys)
+    uint16_t capacity;      // Maximum number of registered nodes (excluding the root)
+    uint8_t *deferred;      // Bitmap of the nodes, whose deletion is deferred until all iterators are closed (parallel to keys)
+    uint16_t deferred_count; // Number of nodes marked in deferred
+    uint16_t *index;        // Open-addressing hash-index over keys (slot-value = position in keys + 1, 0 = empty slot)
+    uint16_t index_size;    // Number of slots in index (always a power of two)
+    struct mesh_device_wheel_link_type *wheel_links; // Links of the nodes into the timing-wheel (parallel to keys)
+    struct mesh_device_tree_type *tree; // Links of the nodes into the routing-tree (parallel to keys)
+    uint16_t root_child;    // Position of the first child-node of the root
+    uint16_t root_size;     // Number of nodes in the root's subtree (including the root itself)
+    uint32_t digest;        // Sum of the hash-values of the registered nodes' MAC-addresses (cf. mesh_device_list_version)
+    uint16_t wheel[MESH_DEVICE_WHEEL_SLOTS];  // First node of every bucket of the timing-wheel
+    uint32_t wheel_tick;    // Last tick of the timing-wheel, that has been processed
+#if MESH_DEVICE_OUI_COMPRESSION
+    struct mesh_device_oui_type oui[MESH_DEVICE_OUI_SLOTS];  // OUI-dictionary, which the keys refer to
+#endif
+};
+
+struct mesh_device_iter_type {
+    uint32_t generation;      // Generation of the device-list at the time the iterator was opened
+    uint16_t pos;             // Position of the next node
+    uint16_t count;           // Number of nodes at the time the iterator was opened; nodes added afterwards are not visited
+};
+
+struct mesh_device_stats_type {
+    uint32_t alloc_count;     // Number of heap-allocations done by the device-list
+    uint16_t capacity;        // Size of the node-pool
+    uint16_t high_water;      // Maximum number of simultaneously registered nodes
+    uint32_t overflow_count;  // Number of nodes, that were dropped because the node-pool was exhausted
+};
+
+typedef void (*mesh_device_change_handler)(const struct mesh_device_mac_type *node, bool added); // Handler-function prototype
+
+struct mesh_device_sync_type {
+    uint16_t added;           // Number of newly registered nodes
+    uint16_t removed;         // Number of expired nodes, that have been deleted
+    uint16_t refreshed;       // Number of already registered nodes, whose timestamp has been updated
 };
 
 /*------------ functions -------------*/
@@ -31,12 +103,31 @@ struct mesh_device_list_type {
 void mesh_device_list_init(void);
 void mesh_device_list_release(void);
 void mesh_device_list_disp(void);
+void mesh_device_change_handler_set(mesh_device_change_handler handler);
+void mesh_device_timeout_set(uint32_t timeout);
+void mesh_device_stats_get(struct mesh_device_stats_type *stats);
 bool mesh_device_list_search(struct mesh_device_mac_type *node);
 bool mesh_device_update_timestamp(struct mesh_device_mac_type *nodes, uint16_t count);
-bool mesh_device_list_get(const struct mesh_device_node_type **nodes, uint16_t *count);
+bool mesh_device_refresh(void);
+uint16_t mesh_device_list_count(void);
+uint32_t mesh_device_list_version(void);
+bool mesh_device_iter_open(struct mesh_device_iter_type *iter);
+bool mesh_device_iter_next(struct mesh_device_iter_type *iter, struct mesh_device_node_type *node);
+bool mesh_device_iter_close(struct mesh_device_iter_type *iter);
 bool mesh_device_root_set(struct mesh_device_mac_type *root);
 bool mesh_device_root_get(const struct mesh_device_node_type **root);
 bool mesh_device_add(struct mesh_device_mac_type *nodes, uint16_t count);
+bool mesh_device_add_aged(struct mesh_device_mac_type *node, uint32_t age);
 bool mesh_device_del(struct mesh_device_mac_type *nodes, uint16_t count);
+uint16_t mesh_device_expire(void);
+bool mesh_device_link(struct mesh_device_mac_type *node, struct mesh_device_mac_type *parent);
+bool mesh_device_parent_get(struct mesh_device_mac_type *node, struct mesh_device_mac_type *parent);
+uint8_t mesh_device_depth_get(struct mesh_device_mac_type *node);
+uint16_t mesh_device_subtree_count(struct mesh_device_mac_type *node);
+uint16_t mesh_device_subtree_get(struct mesh_device_mac_type *node, struct mesh_device_mac_type *nodes, uint16_t count);
+bool mesh_device_sync_begin(struct mesh_device_mac_type *root);
+bool mesh_device_sync_nodes(struct mesh_device_mac_type *nodes, uint16_t count);
+bool mesh_device_sync_end(struct mesh_device_sync_type *result);
+bool mesh_device_sync(struct mesh_device_mac_type *root, struct mesh_device_mac_type *nodes, uint16_t count, struct mesh_device_sync_type *result);
 
 #endif
@@ -0,0 +1,40 @@
+// mesh_device_flash.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+
+#ifndef __MESH_DEVICE_FLASH_H__
+#define __MESH_DEVICE_FLASH_H__
+
+#include "c_types.h"
+#include "mesh_device.h"
+
+/*------------- defines --------------*/
+
+#define MESH_DEVICE_FLASH_MAGIC 0x4D445631 // Identifies a snapshot of the list of registered nodes ("MDV1")
+
+/*------------- structs --------------*/
+
+// The structs are naturally aligned (and not packed), so that they can be passed
+// to spi_flash_read/spi_flash_write directly
+
+struct mesh_device_flash_header_type {
+    uint32_t magic;         // MESH_DEVICE_FLASH_MAGIC
+    uint32_t seq;           // Sequence-number; the valid snapshot with the highest one is the current one
+    uint32_t checksum;      // FNV-1a-hash over the nodes, seq, count and root
+    uint16_t count;         // Number of nodes following the header
+    struct mesh_device_mac_type root;
+};
+
+struct mesh_device_flash_node_type {
+    struct mesh_device_mac_type mac_addr;
+    uint16_t age;           // Time between the node's and the root's last confirmation before the snapshot was written (in s)
+};
+
+/*------------ functions -------------*/
+
+bool mesh_device_flash_load(void);
+bool mesh_device_flash_save(bool force);
+
+#endif
@@ -7,9 +7,50 @@
 #ifndef __MESH_NONE_H__
 #define __MESH_NONE_H__
 
+#include "c_types.h"
+#include "mesh_device.h"
+#include "mesh_parser.h"
+
+/*------------- defines --------------*/
+
+#define MESH_NONE_USR_OPTION_NODES_MAX ((ESP_MESH_OPTION_MAX_LEN-ESP_MESH_OPTION_HLEN-1)/ESP_MESH_ADDR_LEN) // Maximum number of MAC-addresses per user-option (the first byte of its value holds the subtype)
+
+/*-------- structs and types ---------*/
+
+// Subtypes of the user-options (M_O_USR_OPTION) attached to topology-requests,
+// -deltas and -snapshots; the first byte of the option's value holds the subtype
+enum mesh_none_usr_option_type {
+    MESH_NONE_USR_OPTION_PARENT = 0,  // Value: MAC-address of the sender's parent-node
+    MESH_NONE_USR_OPTION_SEQ,         // Value: sequence-number of a topology-delta (16 bit, big-endian) and the root's backoff-level (8 bit)
+    MESH_NONE_USR_OPTION_ADD,         // Value: MAC-addresses of the nodes, that joined the root's device-list (at most MESH_NONE_USR_OPTION_NODES_MAX); follows the MESH_NONE_USR_OPTION_SEQ-option of a topology-delta
+    MESH_NONE_USR_OPTION_DEL,         // Value: MAC-addresses of the nodes, that left the root's device-list (at most MESH_NONE_USR_OPTION_NODES_MAX); follows the MESH_NONE_USR_OPTION_SEQ-option of a topology-delta
+    MESH_NONE_USR_OPTION_REQUEST,     // Value: version of the sender's device-list (32 bit, big-endian; optional); requests a topology-snapshot from the root-node
+    MESH_NONE_USR_OPTION_SNAPSHOT,    // Value: sequence-number of the next topology-delta (16 bit, big-endian), the root's backoff-level, index and number of parts of the snapshot (8 bit each) and the MAC-address of the root-node
+    MESH_NONE_USR_OPTION_NODES,       // Value: MAC-addresses of the nodes of a part of a topology-snapshot (at most MESH_NONE_USR_OPTION_NODES_MAX); follows the part's MESH_NONE_USR_OPTION_SNAPSHOT-option
+    MESH_NONE_USR_OPTION_UNCHANGED,   // Value: sequence-number of the next topology-delta (16 bit, big-endian), the root's backoff-level (8 bit), the version of the sender's device-list (32 bit, big-endian) and the MAC-address of the root-node; replaces the snapshot, if the requester's device-list is up to date
+};
+
+struct mesh_none_snapshot_part_type {
+    struct mesh_device_mac_type *nodes; // MAC-addresses of the nodes of a buffered part of a topology-snapshot (NULL = free entry)
+    uint16_t count;           // Number of MAC-addresses
+    uint8_t part;             // Index of the part
+};
+
+struct mesh_topology_stats_type {
+    uint32_t interval;        // Current interval between two topology-tests (in ms)
+    uint32_t change_rate;     // Smoothed number of nodes joining or leaving the device-list per hour
+    uint32_t change_count;    // Total number of nodes, that joined or left the device-list
+    uint32_t request_count;   // Number of full topology-requests, that have been sent
+    uint32_t snapshot_count;  // Number of topology-snapshots, that have been broadcasted (root-node only)
+    uint32_t relay_count;     // Number of topology-requests of child-nodes, that have been answered from the own device-list
+    uint32_t unchanged_count; // Number of topology-requests, that have been answered by the short reply, since the requester's device-list was up to date
+};
+
 /*------------ functions -------------*/
 
-void mesh_parser_protocol_none(const void *mesh_header, uint8_t *data, uint16_t len);
+void mesh_parser_protocol_none(const struct mesh_parser_view_type *view, void *ctx);
+void mesh_topology_trigger(void);
+void mesh_topology_stats_get(struct mesh_topology_stats_type *stats);
 void mesh_topology_disable(void);
 void mesh_topology_init(void);
 
@@ -8,18 +8,56 @@
 #define __MESH_PARSER_H__
 
 #include "c_types.h"
+#include "mesh.h"
+
+/*------------- defines --------------*/
+
+#define MESH_PARSER_PROTOCOL_SLOTS 64 // Number of entries of the dispatch-table (the protocol-field of the mesh-header is 6 bit wide)
+#define MESH_PARSER_OPTION_TYPES (M_O_USR_OPTION+1) // Number of known option-types (cf. enum mesh_option_type)
+#define MESH_PARSER_OPTIONS_MAX 32    // Maximum number of options of a packet, that can be parsed
+#define MESH_PARSER_OPTION_NONE 0xFF  // Marks the end of the options of a type in the parsed packet-view
 
 /*-------- structs and types ---------*/
 
-typedef void (*mesh_parser_protocol_handler)(const void *mesh_header, uint8_t *data, uint16_t len); // Handler-function prototype
+// Reasons, for which the parser drops a received packet (cf.
+// mesh_parser_drops_get)
+enum mesh_parser_drop_type {
+  MESH_PARSER_DROP_LENGTH = 0,  // Received length is shorter than the mesh-header or exceeds ESP_MESH_PKT_LEN_MAX
+  MESH_PARSER_DROP_VERSION,     // Version of the mesh-header isn't ESP_MESH_VER
+  MESH_PARSER_DROP_HEADER,      // Length-fields of the mesh-header or the option-list exceed the packet
+  MESH_PARSER_DROP_PROTOCOL,    // Communication-protocol isn't supported
+  MESH_PARSER_DROP_OPTIONS,     // An option exceeds the option-list or there are more than MESH_PARSER_OPTIONS_MAX
+  MESH_PARSER_DROP_REASONS,     // Number of reasons
+};
+
+// Parsed view of a received packet: the options are indexed once by the parser
+// and chained by their type, so that the handler-functions don't have to
+// rescan the packet for every option (cf. mesh_parser_option_next)
+struct mesh_parser_view_type {
+  struct mesh_header_format *header;
+  uint8_t *usr_data;        // User-data of the packet (the packet itself, if it doesn't contain any, e.g. in case of a topology-request)
+  uint16_t usr_data_len;
+  uint16_t len;             // Length of the packet
+  uint8_t option_count;
+  uint8_t option_first[MESH_PARSER_OPTION_TYPES];  // Index of the first option of every type (MESH_PARSER_OPTION_NONE = none)
+  uint8_t option_next[MESH_PARSER_OPTIONS_MAX];    // Index of the next option of the same type
+  struct mesh_header_option_format *options[MESH_PARSER_OPTIONS_MAX]; // Options in the order of the packet
+};
+
+typedef void (*mesh_parser_protocol_handler)(const struct mesh_parser_view_type *view, void *ctx); // Handler-function prototype
 
 struct mesh_parser_protocol_type {
-  uint8_t protocol;
   mesh_parser_protocol_handler handler;
+  void *ctx;                // Context passed on to the handler-function
+  uint32_t hits;            // Number of packets, that have been passed on to the handler-function
 };
 
 /*------------ functions -------------*/
 
 void mesh_packet_parser(void *arg, uint8_t *data, uint16_t len);
+bool mesh_parser_register(uint8_t protocol, mesh_parser_protocol_handler handler, void *ctx);
+uint32_t mesh_parser_hits_get(uint8_t protocol);
+uint32_t mesh_parser_drops_get(uint8_t reason);
+struct mesh_header_option_format *mesh_parser_option_next(const struct mesh_parser_view_type *view, uint8_t otype, uint8_t *pos);
 
 #endif
@@ -0,0 +1,51 @@
+// mesh_pool.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+
+#ifndef __MESH_POOL_H__
+#define __MESH_POOL_H__
+
+#include "c_types.h"
+#include "mesh.h"
+
+/*------------- defines --------------*/
+
+#define MESH_POOL_LARGE_SIZE ESP_MESH_PKT_LEN_MAX  // Size of the large buffers (a whole packet)
+
+/*-------- structs and types ---------*/
+
+// Sizes of the buffers of the pool
+enum mesh_pool_class_type {
+    MESH_POOL_SMALL = 0,      // MESH_POOL_SMALL_SIZE (e.g. a topology-request or a short option-list)
+    MESH_POOL_LARGE,          // MESH_POOL_LARGE_SIZE
+    MESH_POOL_CLASSES,        // Number of sizes
+};
+
+struct mesh_pool_stats_type {
+    uint16_t size;            // Size of the buffers (in byte)
+    uint8_t count;            // Number of buffers
+    uint8_t used;             // Number of currently acquired buffers
+    uint8_t used_max;         // Maximum number of simultaneously acquired buffers (high-water-mark)
+    uint32_t acquired;        // Number of acquired buffers
+    uint32_t fallbacks;       // Number of requests of this size, which had to be served by the heap, since all suitable buffers were in use
+};
+
+// Buffers of one size; the free ones are kept as a stack of their indices, so
+// that they are acquired and released in O(1)
+struct mesh_pool_slab_type {
+    uint8_t *buf;             // First buffer (the buffers are stored back to back)
+    uint8_t *free;            // Indices of the free buffers
+    uint8_t *in_use;          // Bitmap of the acquired buffers (so that a buffer, that isn't acquired, can't be released)
+    uint8_t free_count;
+    struct mesh_pool_stats_type stats;
+};
+
+/*------------ functions -------------*/
+
+void *mesh_pool_acquire(uint16_t size);
+void mesh_pool_release(void *buf);
+void mesh_pool_stats_get(uint8_t pool_class, struct mesh_pool_stats_type *stats);
+
+#endif
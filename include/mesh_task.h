@@ -0,0 +1,37 @@
+// mesh_task.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+
+#ifndef __MESH_TASK_H__
+#define __MESH_TASK_H__
+
+#include "c_types.h"
+
+/*-------- structs and types ---------*/
+
+typedef void (*mesh_task_handler)(void *arg, uint8_t *data, uint16_t len); // Handler-function prototype (cf. mesh_packet_parser)
+
+struct mesh_task_entry_type {
+    mesh_task_handler handler;
+    void *arg;                // Argument passed on to the handler-function
+    uint8_t *data;            // Copy of the data passed on to the handler-function (NULL for an event without data)
+    uint16_t len;
+};
+
+struct mesh_task_stats_type {
+    uint32_t processed;       // Number of processed entries
+    uint32_t dropped;         // Number of entries, that have been dropped, since the queue was full or out of memory
+    uint32_t slices;          // Number of runs of the task
+    uint8_t pending_max;      // Maximum number of pending entries
+};
+
+/*------------ functions -------------*/
+
+bool mesh_task_post(mesh_task_handler handler, void *arg, const uint8_t *data, uint16_t len);
+void mesh_task_stats_get(struct mesh_task_stats_type *stats);
+void mesh_task_release(void);
+bool mesh_task_init(void);
+
+#endif
@@ -0,0 +1,41 @@
+// mesh_tx.h
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+
+#ifndef __MESH_TX_H__
+#define __MESH_TX_H__
+
+#include "c_types.h"
+#include "espconn.h"
+#include "mesh.h"
+
+/*-------- structs and types ---------*/
+
+struct mesh_tx_entry_type {
+    struct espconn *conn;     // Connection to send the packet with
+    uint8_t *data;            // Copy of the packet
+    uint16_t len;
+    uint8_t attempts;         // Number of failed attempts to send the packet
+};
+
+struct mesh_tx_stats_type {
+    uint32_t sent;            // Number of sent packets
+    uint32_t queued;          // Number of packets, that couldn't be sent right away and have been queued
+    uint32_t dropped;         // Number of packets, that have been dropped (queue full, out of memory, permanent error or too many attempts)
+    uint32_t retries;         // Number of failed attempts to send a queued packet
+    uint32_t pauses;          // Number of times, the transmission has been paused by the parent-node
+    uint8_t depth;            // Number of queued packets
+    uint8_t depth_max;        // Maximum number of queued packets
+};
+
+/*------------ functions -------------*/
+
+bool mesh_tx_send(struct espconn *conn, uint8_t *data, uint16_t len);
+void mesh_tx_congest_handle(const struct mesh_header_format *header);
+void mesh_tx_stats_get(struct mesh_tx_stats_type *stats);
+void mesh_tx_release(void);
+bool mesh_tx_init(void);
+
+#endif
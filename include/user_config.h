@@ -52,10 +52,44 @@
                     // heap_required = (4^MAX_HOPS-1)/3*6 [byte]
                     // => e.g. 510 byte for MAX_HOPS = 4
 
+#define MESH_DEVICE_FAN_OUT 4 // Expected maximum number of child-nodes per mesh-
+                              // node; together with MAX_HOPS, this determines
+                              // the capacity of the list of registered nodes,
+                              // which is allocated once at initialization:
+                              // capacity = (FAN_OUT^MAX_HOPS-1)/(FAN_OUT-1)
+                              // => e.g. 85 nodes (~2.9 kbyte incl. hash-index
+                              // and routing-tree, ~2.3 kbyte with
+                              // MESH_DEVICE_OUI_COMPRESSION) for MAX_HOPS = 4
+
+#ifndef MESH_DEVICE_OUI_COMPRESSION
+#define MESH_DEVICE_OUI_COMPRESSION 0 // Store the registered nodes in compressed
+                                      // form (1) or not (0); if enabled, only
+                                      // the NIC-specific part of the MAC-
+                                      // address and the index of its OUI in a
+                                      // small dictionary (cf. MESH_DEVICE_OUI_
+                                      // SLOTS) as well as a timestamp in
+                                      // seconds are stored per node (6 instead
+                                      // of 12 byte); nodes with further OUIs
+                                      // are dropped, once the dictionary is
+                                      // full; may be set by the build (-D)
+#endif
+
 #define SUB_NODE_TIMEOUT_THRESHOLD 30000  // Time, after which a non-responsive
                                           // device is deleted from the list of
                                           // registered nodes (in ms)
 
+#define MESH_DEVICE_FLASH_SAVE_INTERVAL 600000  // Minimum time-interval between
+                                                // two snapshots of the list of
+                                                // registered nodes, which are
+                                                // written to the two flash-
+                                                // sectors directly below the
+                                                // rf-calibration-sector (cf.
+                                                // user_rf_cal_sector_set) to
+                                                // restore it after a restart;
+                                                // snapshots are only written,
+                                                // if the registered nodes have
+                                                // changed (in ms)
+
 #define OUTPUT_POWER_RELAY_GPIO 12  // GPIO-pin, that is connected to the red LED
                                     // as well as to the relay, which controls
                                     // the smart plug's output power; the blue
@@ -109,10 +143,116 @@
 
 /*------------------------------------*/
 
+// Deferred processing:
+
+#define MESH_TASK_PRIO USER_TASK_PRIO_0 // Priority of the task, which processes
+                                        // the received packets and the timer-
+                                        // events (cf. mesh_task.c); the lowest
+                                        // one, so that the WiFi-stack isn't
+                                        // starved
+
+#define MESH_TASK_QUEUE_LEN 16  // Maximum number of received packets and
+                                // timer-events, which are queued for the task;
+                                // further packets are dropped
+
+#define MESH_TASK_QUEUE_RESERVED 4  // Number of entries of the queue, that are
+                                    // reserved for timer-events (which don't
+                                    // carry any data)
+
+#define MESH_TASK_SLICE 2000  // Maximum duration of a single run of the task;
+                              // the remaining entries of the queue are
+                              // processed by the next run (in us)
+
+/*------------------------------------*/
+
+// Packet-buffers:
+
+#define MESH_POOL_SMALL_SIZE 128  // Size of the small buffers of the pool of
+                                  // packet-buffers (cf. mesh_pool.c), which
+                                  // hold short packets like topology-requests
+                                  // (in byte)
+
+#define MESH_POOL_SMALL_COUNT 12  // Number of small packet-buffers
+
+#define MESH_POOL_LARGE_COUNT 4 // Number of large packet-buffers, which hold a
+                                // whole packet (ESP_MESH_PKT_LEN_MAX); if all
+                                // suitable buffers are in use, packets are
+                                // allocated from the heap
+
+/*------------------------------------*/
+
+// Transmit-queue:
+
+#define MESH_TX_QUEUE_LEN 8 // Maximum number of packets, which are queued, if
+                            // they can't be sent right away; further packets
+                            // are dropped
+
+#define MESH_TX_RETRY_INTERVAL 50 // Time-interval, after which sending a queued
+                                  // packet is retried; doubled after every
+                                  // failed attempt (in ms)
+
+#define MESH_TX_RETRY_INTERVAL_MAX 1600 // Maximum time-interval between two
+                                        // attempts to send a queued packet (in
+                                        // ms)
+
+#define MESH_TX_RETRY_MAX 6 // Maximum number of attempts to send a packet,
+                            // before it's dropped
+
+#define MESH_TX_PAUSE_TIMEOUT 2000  // Time limit to receive the congestion-
+                                    // permit from the parent-node, after which
+                                    // the paused transmission is resumed
+                                    // anyway (in ms)
+
+/*------------------------------------*/
+
 // Topology-tests:
 
 #define TOPOLOGY_TIME_INTERVAL 15000  // Time-interval, in which a topology-test
-                                      // is executed (in ms)
+                                      // is executed, while the topology is
+                                      // changing (in ms)
+
+#define TOPOLOGY_TIME_INTERVAL_MAX 240000 // Maximum time-interval between two
+                                          // topology-tests; as long as no node
+                                          // joins or leaves, the interval is
+                                          // doubled after every topology-test
+                                          // up to this limit (in ms)
+
+#define TOPOLOGY_DELTA_MAX 16 // Maximum number of nodes joining or leaving the
+                              // root-node's device-list, that are collected for
+                              // a single topology-delta; if more nodes change
+                              // within one topology-test-interval, the other
+                              // nodes fall back to a full topology-request
+                              // (at most MESH_NONE_USR_OPTION_NODES_MAX = 42)
+
+#define TOPOLOGY_SNAPSHOT_WINDOW 1000 // Time-interval, in which the root-node
+                                      // collects topology-requests, before it
+                                      // answers all of them with a single
+                                      // broadcast of its device-list (in ms)
+
+#define TOPOLOGY_SNAPSHOT_BUFFERS 2 // Maximum number of parts of a topology-
+                                    // snapshot, which are buffered, if they
+                                    // arrive ahead of a missing one; a snapshot
+                                    // missing more parts is discarded
+
+#define TOPOLOGY_SNAPSHOT_TIMEOUT 5000  // Time-interval, in which all parts of a
+                                        // topology-snapshot have to be
+                                        // received; an incomplete snapshot is
+                                        // discarded afterwards (in ms)
+
+#define TOPOLOGY_DELTA_TIMEOUT 4  // Number of the root-node's topology-test-
+                                  // intervals without a topology-delta from it,
+                                  // after which a non-root-node falls back to a
+                                  // full topology-request; must be greater than
+                                  // 2, since the root may double its interval
+                                  // after announcing it
+
+#define TOPOLOGY_TIMEOUT_TESTS 2  // Number of topology-test-intervals, after
+                                  // which a node, that has been missing from
+                                  // the topology-tests, is deleted from the
+                                  // list of registered nodes (at least after
+                                  // SUB_NODE_TIMEOUT_THRESHOLD), so that a
+                                  // single missed topology-test doesn't delete
+                                  // it at a long interval
 
 /*------------------------------------*/
 
@@ -42,6 +42,9 @@
 #include "mesh.h"
 #include "device_info.h"
 #include "mesh_parser.h"
+#include "mesh_none.h"
+#include "mesh_task.h"
+#include "mesh_tx.h"
 #include "esp_touch.h"
 #include "user_config.h"
 
@@ -100,13 +103,15 @@ static uint8_t esp_mesh_enable_attempt_count = 1;
 
 // Callback-function, that passes received messages from other nodes to the parser
 static void ICACHE_FLASH_ATTR esp_mesh_recv_cb(void *arg, char *data, uint16_t len) {
-  if (!arg || !data || len <= 0) {
+  if (!arg || !data) {
     os_printf("esp_mesh_recv_cb: Invalid transfer paramters!\n");
     return;
   }
 
-  // Pass the received data to the parser
-  mesh_packet_parser(arg, data, len);
+  // Queue the received data for the parser (which also validates its length
+  // and counts invalid packets instead of printing them), so that the callback
+  // returns immediately; the packet is dropped, if the queue is full
+  mesh_task_post(mesh_packet_parser, arg, (uint8_t *) data, len);
 }
 
 // Callback-function, that notifies, if a new sub-node joins the mesh-network
@@ -117,6 +122,9 @@ static void ICACHE_FLASH_ATTR esp_mesh_node_join_cb(void *mac) {
   }
 
   os_printf("esp_mesh_node_join_cb: New sub-node joined: " MACSTR "\n", MAC2STR((uint8_t *) mac));
+
+  // The topology has changed; check it more often again
+  mesh_topology_trigger();
 }
 
 // Callback-function, that is executed, if the mesh-network fails to be rebuild;
@@ -124,6 +132,9 @@ static void ICACHE_FLASH_ATTR esp_mesh_node_join_cb(void *mac) {
 static void ICACHE_FLASH_ATTR esp_mesh_rebuild_fail_cb(void *arg) {
   os_printf("esp_mesh_rebuild_fail_cb: Failed to rebuild mesh!\n");
 
+  // The topology is about to change; check it more often again
+  mesh_topology_trigger();
+
   // Start the timer to toggle the status-LED to signalize, that the
   // enabling of the mesh-node is in progress (long blink-interval)
   if (led_blink_timer) {
@@ -206,6 +217,10 @@ static void ICACHE_FLASH_ATTR esp_mesh_enable_cb(int8_t result) {
       // Try to establish a (virtual) TCP-connection to the specified server (if
       // declared) or to the parent mesh-node if the device is not in LOCAL-mode
       if (!espconn_mesh_connect(esp_mesh_conn) || (espconn_mesh_is_root() && result == MESH_LOCAL_SUC)) {
+        // Initialize the queue, which buffers outgoing packets during a
+        // congestion
+        mesh_tx_init();
+
         // Initialize periodical topology-tests
         // Only enable this, if a sufficient power supply is guaranteed and/or if
         // P2P-communication is required!
@@ -231,6 +246,11 @@ static void ICACHE_FLASH_ATTR esp_mesh_disable_cb(void) {
   // Disable the periodical topology-tests
   mesh_topology_disable();
 
+  // Drop the received packets and timer-events, which haven't been processed
+  // yet, as well as the packets, which haven't been sent yet
+  mesh_task_release();
+  mesh_tx_release();
+
   // Disable all further communication- and interaction-functionalities,
   // including the periodical vital sign broadcasts as well as the possibility
   // to request the devices meta-data
@@ -537,6 +557,13 @@ void user_init(void) {
     return;
   }
 
+  // Register the task, which processes the received packets and the timer-
+  // events outside of the SDK's callbacks
+  if (!mesh_task_init()) {
+    os_printf("user_init: Error while registering the task! Aborting!\n");
+    return;
+  }
+
   mesh_init();
 }
 
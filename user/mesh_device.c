@@ -17,44 +17,728 @@
 
 static struct mesh_device_list_type *node_list = NULL;
 
-// The following can be used to create copies of node_list->list and
-// node_list->root, which can then be returned by the get-functions, and
-// therefore to create a real safe coupling/read-only towards the outside (since
-// "const" can be tricked quite easily by explicit typecasting). Doing so should
-// be considered if you have enough memory space. Since that isn't the case
-// everytime, the standard-implementation of the get-methods "just" returns the
-// actual references of node_list->root and node_list->list as "const", which is,
-// of course, much more memory saving and microcontroller-friendly. But therefore
-// it is possible to manipulate the "working"-data from the outside, so remember:
-// WARNING: IF YOU MANIPULATE THE ACTUAL DATA OF NODE_LIST->LIST OR
-// NODE_LIST->ROOT, THE MESH-FUNCTIONALITY MIGHT NO LONGER BE GIVEN!
-/* static struct mesh_device_node_type *node_list_list_cpy = NULL;  // Serves as a copy of node_list->list to ensure that nobody
- *                                                                  // can manipulate node_list->list from the outside; also
- *                                                                  // prevents problems when calling the list from the outside
- *                                                                  // after it was freed internally
- *                                                                  // (e.g. if node_list->entries_count <= 1)
- * static struct mesh_device_node_type *node_list_root_cpy = NULL;  // Same reasoning as for node_list_list_cpy (just for
- *                                                                  // node_list->root instead of node_list->list)
+static struct mesh_device_stats_type node_list_stats; // Usage-statistics of the heap and of the node-pool
+
+static struct mesh_device_sync_type node_list_sync;   // Summary of the currently running reconciliation
+static bool node_list_sync_running = false;
+
+static uint32_t node_list_generation = 0; // Incremented whenever the positions of the registered nodes are invalidated (reset or release of the device-list)
+static uint16_t node_list_iterators = 0;  // Number of currently open iterators
+
+static mesh_device_change_handler node_list_change_handler = NULL; // Notified whenever a node joins or leaves the list (cf. mesh_device_change_handler_set)
+
+static uint32_t node_list_timeout = SUB_NODE_TIMEOUT_THRESHOLD; // Time, after which a non-responsive node is deleted (in ms; cf. mesh_device_timeout_set)
+
+static uint32_t node_list_clock_ms = 0, node_list_clock_us = 0; // Monotonic millisecond-clock for the timing-wheel (system_get_time overflows after ~71 minutes)
+
+// The registered nodes are stored as structure-of-arrays: the MAC-addresses are
+// packed into integer-keys (cf. mesh_device_key) in one array and the timestamps
+// are kept in a parallel one. Thus, lookups compare words instead of calling
+// os_memcmp on unaligned, packed structs and the expiry only touches the
+// timestamps. Towards the outside, a node is still represented by struct
+// mesh_device_node_type, which is assembled on request by mesh_device_iter_next
+// (so the working-data of node_list can't be manipulated from the outside).
+// Additionally, the routing-tree is encoded in an array parallel to the keys:
+// every node references its parent, its first child and its next sibling by
+// their positions and keeps its depth as well as the size of its subtree, so
+// that the depth and the number of nodes below a node can be queried in O(1)
+// and the nodes below it can be listed in O(subtree).
+// If MESH_DEVICE_OUI_COMPRESSION is enabled, the keys only consist of the NIC-
+// specific part of the MAC-address and the index of its OUI in a small
+// dictionary (the nodes of a mesh usually share one or two OUIs) and the
+// timestamps are stored in seconds, which halves the size per node.
+//
+// Instead of copying the list, readers iterate it in place (cf.
+// mesh_device_iter_open). Since a deletion moves the last node into the place
+// of the deleted one, deletions are deferred while an iterator is open and
+// applied in one batch when the last one is closed; newly added nodes are
+// appended behind the iterated range. Thus, the positions an iterator visits
+// stay stable and only a reset of the list (e.g. a new root) invalidates it,
+// which is detected by the generation-counter.
+//
+// The following can be used to create a copy of node_list->root, which can then
+// be returned by mesh_device_root_get, and therefore to create a real safe
+// coupling/read-only towards the outside (since "const" can be tricked quite
+// easily by explicit typecasting). Doing so should be considered if you have
+// enough memory space. Since that isn't the case everytime, the standard-
+// implementation "just" returns the actual reference of node_list->root as
+// "const", which is, of course, much more memory saving and microcontroller-
+// friendly. But therefore it is possible to manipulate the "working"-data from
+// the outside, so remember:
+// WARNING: IF YOU MANIPULATE THE ACTUAL DATA OF NODE_LIST->ROOT, THE MESH-
+// FUNCTIONALITY MIGHT NO LONGER BE GIVEN!
+/* static struct mesh_device_node_type *node_list_root_cpy = NULL;  // Serves as a copy of node_list->root to ensure that nobody
+ *                                                                  // can manipulate node_list->root from the outside
  */
 
-// Initialize the list containing the currently registered nodes
+// Minimum number of slots of the hash-index; the index is always at least
+// twice as big as the list's capacity, so that the probe-sequences stay short
+// (load-factor <= 0.5)
+#define MESH_DEVICE_INDEX_SIZE_MIN 16
+
+// Maximum capacity of the node-pool: the hash-index (twice the capacity,
+// rounded up to a power of two) has to be addressable by its uint16_t size
+#define MESH_DEVICE_CAPACITY_MAX 16384
+
+// Return value of mesh_device_index_lookup, if the given MAC-address isn't
+// registered; also marks the end of a bucket of the timing-wheel
+#define MESH_DEVICE_INDEX_NONE 0xFFFF
+
+// Position of the root in the routing-tree (the root isn't part of the list)
+#define MESH_DEVICE_INDEX_ROOT 0xFFFE
+
+// Check whether the deletion of the node at the given position is deferred
+#define mesh_device_node_deferred(pos) (node_list->deferred[(pos) >> 3] & (1 << ((pos) & 7)))
+
+// Return value of mesh_device_key, if the OUI of the given MAC-address isn't
+// part of the OUI-dictionary; never matches a registered node
+#define MESH_DEVICE_KEY_NONE ((mesh_device_key_type) -1)
+
+// Duration of one tick of the timing-wheel (in ms); the wheel spans twice the
+// default timeout-threshold, so that the deadline of every registered node lies
+// within one revolution (deadlines beyond it, cf. mesh_device_timeout_set, are
+// re-linked, whenever their bucket is visited)
+#define MESH_DEVICE_WHEEL_TICK (SUB_NODE_TIMEOUT_THRESHOLD/(MESH_DEVICE_WHEEL_SLOTS/2))
+
+/*------------------------------------*/
+
+// Hash-index:
+
+#if MESH_DEVICE_OUI_COMPRESSION
+// Return the index of the given MAC-address' OUI in the OUI-dictionary; if it
+// isn't part of it yet and add is true, a free entry is assigned to it
+// (entries without references are free); MESH_DEVICE_OUI_SLOTS if there is none
+static uint8_t ICACHE_FLASH_ATTR mesh_device_oui_find(const struct mesh_device_mac_type *node, bool add) {
+  uint8_t idx = 0, free = MESH_DEVICE_OUI_SLOTS;
+
+  for (idx = 0; idx < MESH_DEVICE_OUI_SLOTS; idx++) {
+    if (os_memcmp(node_list->oui[idx].oui, node->mac, sizeof(node_list->oui[idx].oui)) == 0) {
+      return idx;
+    }
+    if (!node_list->oui[idx].refs && free == MESH_DEVICE_OUI_SLOTS) {
+      free = idx;
+    }
+  }
+  if (add && free < MESH_DEVICE_OUI_SLOTS) {
+    os_memcpy(node_list->oui[free].oui, node->mac, sizeof(node_list->oui[free].oui));
+  }
+  return add ? free : MESH_DEVICE_OUI_SLOTS;
+}
+
+// Pack the NIC-specific part of the given MAC-address and the index of its OUI
+// into an integer-key; returns MESH_DEVICE_KEY_NONE, if the OUI isn't part of
+// the OUI-dictionary (and can't be added to it, if add is true)
+static mesh_device_key_type ICACHE_FLASH_ATTR mesh_device_key_get(const struct mesh_device_mac_type *node, bool add) {
+  uint8_t oui = mesh_device_oui_find(node, add);
+
+  if (oui >= MESH_DEVICE_OUI_SLOTS) {
+    return MESH_DEVICE_KEY_NONE;
+  }
+  return ((uint32_t) oui << 24) | ((uint32_t) node->mac[3] << 16) | ((uint32_t) node->mac[4] << 8) | (uint32_t) node->mac[5];
+}
+
+#define mesh_device_key(node) mesh_device_key_get(node, false)
+#define mesh_device_key_add(node) mesh_device_key_get(node, true)
+
+// Unpack the given integer-key into a MAC-address
+static void ICACHE_FLASH_ATTR mesh_device_key_mac(mesh_device_key_type key, struct mesh_device_mac_type *node) {
+  os_memcpy(node->mac, node_list->oui[key >> 24].oui, sizeof(node_list->oui[0].oui));
+  node->mac[3] = (key >> 16) & 0xFF;
+  node->mac[4] = (key >> 8) & 0xFF;
+  node->mac[5] = key & 0xFF;
+}
+
+// Account for a node with the given key being registered (refs > 0) or deleted
+// (refs < 0) in the OUI-dictionary
+#define mesh_device_key_ref(key, count) (node_list->oui[(key) >> 24].refs += (count))
+#else
+// Pack the given MAC-address into an integer-key (big-endian, so that the keys
+// sort like the MAC-addresses)
+static mesh_device_key_type ICACHE_FLASH_ATTR mesh_device_key(const struct mesh_device_mac_type *node) {
+  return ((mesh_device_key_type) node->mac[0] << 40) | ((mesh_device_key_type) node->mac[1] << 32) |
+         ((uint32_t) node->mac[2] << 24) | ((uint32_t) node->mac[3] << 16) | ((uint32_t) node->mac[4] << 8) | (uint32_t) node->mac[5];
+}
+
+#define mesh_device_key_add(node) mesh_device_key(node)
+
+// Unpack the given integer-key into a MAC-address
+static void ICACHE_FLASH_ATTR mesh_device_key_mac(mesh_device_key_type key, struct mesh_device_mac_type *node) {
+  uint8_t idx = sizeof(struct mesh_device_mac_type);
+
+  while (idx-- > 0) {
+    node->mac[idx] = key & 0xFF;
+    key >>= 8;
+  }
+}
+
+#define mesh_device_key_ref(key, count)
+#endif
+
+// Calculate the hash-value of the given key; the last three bytes (NIC-specific
+// part of the MAC-address) carry most of the entropy, since the nodes of a mesh
+// usually share the same OUI (vendor-specific part), so they are weighted the
+// most
+static uint16_t ICACHE_FLASH_ATTR mesh_device_index_hash(mesh_device_key_type key) {
+  uint32_t hash = (uint32_t) key ^ (uint32_t) (key >> 24); // (key >> 24) only contains the OUI-index in compressed form
+
+  hash *= 2654435761u;  // Multiplicative hashing (Knuth); the upper bits are the best mixed ones
+  return (uint16_t) (hash >> 16);
+}
+
+// Return the index-slot, that either contains the given key or is the first
+// empty slot of its probe-sequence (linear probing); since the index is never
+// more than half-full, there always is an empty slot to stop at
+static uint16_t ICACHE_FLASH_ATTR mesh_device_index_slot(mesh_device_key_type key) {
+  uint16_t mask = node_list->index_size-1;
+  uint16_t slot = mesh_device_index_hash(key) & mask;
+
+  while (node_list->index[slot] && node_list->keys[node_list->index[slot]-1] != key) {
+    slot = (slot+1) & mask;
+  }
+  return slot;
+}
+
+// Return the position of the given key in node_list->keys or
+// MESH_DEVICE_INDEX_NONE, if it isn't registered (the root is not part of the
+// index)
+static uint16_t ICACHE_FLASH_ATTR mesh_device_index_lookup(mesh_device_key_type key) {
+  if (node_list->entries_count <= 1) {
+    return MESH_DEVICE_INDEX_NONE;
+  }
+
+  uint16_t slot = mesh_device_index_slot(key);
+
+  if (!node_list->index[slot] || mesh_device_node_deferred(node_list->index[slot]-1)) {
+    return MESH_DEVICE_INDEX_NONE;
+  }
+  return node_list->index[slot]-1;
+}
+
+// Empty the given index-slot and move the following entries of the probe-
+// sequence backwards to close the gap (backward-shift-deletion), so that no
+// tombstones are needed and the lookups stay as short as directly after a
+// rebuild
+static void ICACHE_FLASH_ATTR mesh_device_index_clear(uint16_t slot) {
+  uint16_t mask = node_list->index_size-1;
+  uint16_t next = slot, home = 0;
+
+  while (true) {
+    next = (next+1) & mask;
+    if (!node_list->index[next]) {
+      break;
+    }
+    home = mesh_device_index_hash(node_list->keys[node_list->index[next]-1]) & mask;
+    // Only move the entry, if its home-slot doesn't lie cyclically in (slot, next]
+    if ((slot <= next) ? (home <= slot || home > next) : (home <= slot && home > next)) {
+      node_list->index[slot] = node_list->index[next];
+      slot = next;
+    }
+  }
+  node_list->index[slot] = 0;
+}
+
+/*------------------------------------*/
+
+// Timing-wheel:
+
+// Return the current time of the monotonic millisecond-clock; has to be called
+// at least once per ~71 minutes (overflow of system_get_time), which is
+// guaranteed by the periodical topology-tests
+static uint32_t ICACHE_FLASH_ATTR mesh_device_clock(void) {
+  uint32_t elapsed_ms = (system_get_time()-node_list_clock_us)/1000;
+
+  node_list_clock_ms += elapsed_ms;
+  node_list_clock_us += elapsed_ms*1000;  // Keep the sub-millisecond-remainder for the next call
+  return node_list_clock_ms;
+}
+
+// Return the current time in the resolution of the stored timestamps
+static mesh_device_time_type ICACHE_FLASH_ATTR mesh_device_time(void) {
+#if MESH_DEVICE_OUI_COMPRESSION
+  return (mesh_device_time_type) (mesh_device_clock()/1000);
+#else
+  return system_get_time();
+#endif
+}
+
+// Return the time, that has passed between the given timestamp and now (in ms);
+// compressed timestamps overflow after ~18 hours, which doesn't matter, since
+// every node is expired long before
+static uint32_t ICACHE_FLASH_ATTR mesh_device_age(mesh_device_time_type now, mesh_device_time_type timestamp) {
+#if MESH_DEVICE_OUI_COMPRESSION
+  return (uint32_t) (mesh_device_time_type) (now-timestamp)*1000;
+#else
+  return (now-timestamp)/1000;  // Has to be divided by 1000 because the system-time is given in microseconds and not in milliseconds
+#endif
+}
+
+// Unlink the node at the given position from its bucket of the timing-wheel
+static void ICACHE_FLASH_ATTR mesh_device_wheel_unlink(uint16_t pos) {
+  struct mesh_device_wheel_link_type *link = &node_list->wheel_links[pos];
+
+  if (link->prev != MESH_DEVICE_INDEX_NONE) {
+    node_list->wheel_links[link->prev].next = link->next;
+  }
+  else {
+    node_list->wheel[link->bucket] = link->next;
+  }
+  if (link->next != MESH_DEVICE_INDEX_NONE) {
+    node_list->wheel_links[link->next].prev = link->prev;
+  }
+}
+
+// Link the node at the given position into the bucket of the given tick of the
+// timing-wheel
+static void ICACHE_FLASH_ATTR mesh_device_wheel_link(uint16_t pos, uint32_t tick) {
+  struct mesh_device_wheel_link_type *link = &node_list->wheel_links[pos];
+
+  link->bucket = tick & (MESH_DEVICE_WHEEL_SLOTS-1);
+  link->prev = MESH_DEVICE_INDEX_NONE;
+  link->next = node_list->wheel[link->bucket];
+  if (link->next != MESH_DEVICE_INDEX_NONE) {
+    node_list->wheel_links[link->next].prev = pos;
+  }
+  node_list->wheel[link->bucket] = pos;
+}
+
+// Reset all buckets of the timing-wheel
+static void ICACHE_FLASH_ATTR mesh_device_wheel_reset(void) {
+  uint8_t bucket = 0;
+
+  for (bucket = 0; bucket < MESH_DEVICE_WHEEL_SLOTS; bucket++) {
+    node_list->wheel[bucket] = MESH_DEVICE_INDEX_NONE;
+  }
+  node_list->wheel_tick = mesh_device_clock()/MESH_DEVICE_WHEEL_TICK;
+}
+
+/*------------------------------------*/
+
+// Routing-tree:
+
+// Return the depth of the node at the given position (or of the root)
+static uint8_t ICACHE_FLASH_ATTR mesh_device_tree_depth(uint16_t pos) {
+  return pos == MESH_DEVICE_INDEX_ROOT ? 0 : node_list->tree[pos].depth;
+}
+
+// Return the reference to the first child of the node at the given position
+// (or of the root)
+static uint16_t * ICACHE_FLASH_ATTR mesh_device_tree_children(uint16_t pos) {
+  return pos == MESH_DEVICE_INDEX_ROOT ? &node_list->root_child : &node_list->tree[pos].child;
+}
+
+// Return the position following the given one in the subtree of top in
+// pre-order (parents before their children) or MESH_DEVICE_INDEX_NONE, if the
+// subtree has been traversed completely
+static uint16_t ICACHE_FLASH_ATTR mesh_device_tree_next(uint16_t top, uint16_t pos) {
+  if (pos == top || node_list->tree[pos].child != MESH_DEVICE_INDEX_NONE) {
+    return *mesh_device_tree_children(pos);
+  }
+  while (pos != top) {
+    if (node_list->tree[pos].sibling != MESH_DEVICE_INDEX_NONE) {
+      return node_list->tree[pos].sibling;
+    }
+    pos = node_list->tree[pos].parent;
+  }
+  return MESH_DEVICE_INDEX_NONE;
+}
+
+// Update the depth of all nodes in the subtree of the given node after it has
+// been (un-)linked
+static void ICACHE_FLASH_ATTR mesh_device_tree_redepth(uint16_t top) {
+  uint16_t pos = top, parent = 0;
+
+  do {
+    parent = node_list->tree[pos].parent;
+    if (parent == MESH_DEVICE_INDEX_NONE || mesh_device_tree_depth(parent) == MESH_DEVICE_DEPTH_UNKNOWN) {
+      node_list->tree[pos].depth = MESH_DEVICE_DEPTH_UNKNOWN;
+    }
+    else {
+      node_list->tree[pos].depth = mesh_device_tree_depth(parent)+1;
+    }
+    pos = mesh_device_tree_next(top, pos);
+  } while (pos != MESH_DEVICE_INDEX_NONE);
+}
+
+// Add the given number of nodes to the subtree-size of the given node and all
+// of its ancestors
+static void ICACHE_FLASH_ATTR mesh_device_tree_resize(uint16_t pos, int16_t delta) {
+  while (pos != MESH_DEVICE_INDEX_NONE && pos != MESH_DEVICE_INDEX_ROOT) {
+    node_list->tree[pos].size += delta;
+    pos = node_list->tree[pos].parent;
+  }
+  if (pos == MESH_DEVICE_INDEX_ROOT) {
+    node_list->root_size += delta;
+  }
+}
+
+// Replace the reference to the node at the given position in its parent's list
+// of children by the given position (MESH_DEVICE_INDEX_NONE removes it)
+static void ICACHE_FLASH_ATTR mesh_device_tree_replace(uint16_t pos, uint16_t replacement) {
+  uint16_t *ref = mesh_device_tree_children(node_list->tree[pos].parent);
+
+  while (*ref != pos) {
+    ref = &node_list->tree[*ref].sibling;
+  }
+  *ref = replacement == MESH_DEVICE_INDEX_NONE ? node_list->tree[pos].sibling : replacement;
+}
+
+// Detach the node at the given position (together with its subtree) from its
+// parent
+static void ICACHE_FLASH_ATTR mesh_device_tree_unlink(uint16_t pos) {
+  if (node_list->tree[pos].parent == MESH_DEVICE_INDEX_NONE) {
+    return;
+  }
+  mesh_device_tree_replace(pos, MESH_DEVICE_INDEX_NONE);
+  mesh_device_tree_resize(node_list->tree[pos].parent, -node_list->tree[pos].size);
+  node_list->tree[pos].parent = MESH_DEVICE_INDEX_NONE;
+  node_list->tree[pos].sibling = MESH_DEVICE_INDEX_NONE;
+}
+
+// Attach the (detached) node at the given position together with its subtree
+// to the given parent
+static void ICACHE_FLASH_ATTR mesh_device_tree_link(uint16_t pos, uint16_t parent) {
+  uint16_t *children = mesh_device_tree_children(parent);
+
+  node_list->tree[pos].parent = parent;
+  node_list->tree[pos].sibling = *children;
+  *children = pos;
+  mesh_device_tree_resize(parent, node_list->tree[pos].size);
+}
+
+// Detach the node at the given position from the tree before it is removed;
+// its children keep their subtrees, but their path to the root is unknown
+// until they are linked again
+static void ICACHE_FLASH_ATTR mesh_device_tree_remove(uint16_t pos) {
+  uint16_t child = 0;
+
+  mesh_device_tree_unlink(pos);
+  while ((child = node_list->tree[pos].child) != MESH_DEVICE_INDEX_NONE) {
+    mesh_device_tree_unlink(child);
+    mesh_device_tree_redepth(child);
+  }
+}
+
+// Redirect all references to the node at the given position to its new
+// position, after it has been moved there (cf. mesh_device_node_remove)
+static void ICACHE_FLASH_ATTR mesh_device_tree_move(uint16_t from, uint16_t to) {
+  uint16_t child = node_list->tree[from].child;
+
+  if (node_list->tree[from].parent != MESH_DEVICE_INDEX_NONE) {
+    mesh_device_tree_replace(from, to);
+  }
+  while (child != MESH_DEVICE_INDEX_NONE) {
+    node_list->tree[child].parent = to;
+    child = node_list->tree[child].sibling;
+  }
+  os_memcpy(&node_list->tree[to], &node_list->tree[from], sizeof(struct mesh_device_tree_type));
+}
+
+// Reset the routing-tree (only the root remains)
+static void ICACHE_FLASH_ATTR mesh_device_tree_reset(void) {
+  node_list->root_child = MESH_DEVICE_INDEX_NONE;
+  node_list->root_size = 1;
+}
+
+/*------------------------------------*/
+
+// Node-pool:
+
+// Calculate the hash-value of the given MAC-address, that contributes to the
+// version of the list (cf. mesh_device_list_version); independent of the key,
+// so that it is the same with and without MESH_DEVICE_OUI_COMPRESSION
+static uint32_t ICACHE_FLASH_ATTR mesh_device_mac_hash(const struct mesh_device_mac_type *node) {
+  uint32_t hash = 2166136261u;  // FNV-1a
+  uint8_t idx = 0;
+
+  for (idx = 0; idx < sizeof(struct mesh_device_mac_type); idx++) {
+    hash ^= node->mac[idx];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Account for the node at the given position joining or leaving the list in its
+// version and notify the registered change-handler (if any) about it
+static void ICACHE_FLASH_ATTR mesh_device_node_notify(uint16_t pos, bool added) {
+  struct mesh_device_mac_type node;
+
+  mesh_device_key_mac(node_list->keys[pos], &node);
+  if (added) {
+    node_list->digest += mesh_device_mac_hash(&node);
+  }
+  else {
+    node_list->digest -= mesh_device_mac_hash(&node);
+  }
+  if (node_list_change_handler) {
+    node_list_change_handler(&node, added);
+  }
+}
+
+// Set the timestamp of the node at the given position to the given time (cf.
+// mesh_device_time) and (re-)link it into the bucket of its new expiry-deadline
+static void ICACHE_FLASH_ATTR mesh_device_node_refresh(uint16_t pos, mesh_device_time_type timestamp, bool linked) {
+  if (linked) {
+    mesh_device_wheel_unlink(pos);
+  }
+  node_list->timestamps[pos] = timestamp;
+  mesh_device_wheel_link(pos, (mesh_device_clock()+node_list_timeout)/MESH_DEVICE_WHEEL_TICK);
+}
+
+// Insert a new node in place at the end of the list and register it at the
+// given (empty) index-slot; return false, if the node-pool (or the OUI-
+// dictionary) is exhausted
+static bool ICACHE_FLASH_ATTR mesh_device_node_insert(uint16_t slot, mesh_device_key_type key, mesh_device_time_type timestamp) {
+  uint16_t pos = node_list->entries_count-1;
+
+  if (pos >= node_list->capacity || key == MESH_DEVICE_KEY_NONE) {
+    node_list_stats.overflow_count++;
+    return false;
+  }
+
+  node_list->keys[pos] = key;
+  mesh_device_key_ref(key, 1);
+  node_list->tree[pos].parent = MESH_DEVICE_INDEX_NONE;
+  node_list->tree[pos].child = MESH_DEVICE_INDEX_NONE;
+  node_list->tree[pos].sibling = MESH_DEVICE_INDEX_NONE;
+  node_list->tree[pos].size = 1;
+  node_list->tree[pos].depth = MESH_DEVICE_DEPTH_UNKNOWN;
+  node_list->index[slot] = pos+1;
+  node_list->entries_count++;
+  mesh_device_node_refresh(pos, timestamp, false);
+  mesh_device_node_notify(pos, true);
+
+  if (node_list->entries_count-1 > node_list_stats.high_water) {
+    node_list_stats.high_water = node_list->entries_count-1;
+  }
+  return true;
+}
+
+// Remove the node referenced by the given index-slot from the list; the last
+// node of the list is moved into its place (the order of the list doesn't
+// matter, so this saves shifting every further node one place to the front)
+static void ICACHE_FLASH_ATTR mesh_device_node_remove(uint16_t slot) {
+  uint16_t pos = node_list->index[slot]-1;
+  uint16_t last = node_list->entries_count-2;
+  struct mesh_device_wheel_link_type *link = NULL;
+
+  mesh_device_key_ref(node_list->keys[pos], -1);
+  mesh_device_index_clear(slot);
+  mesh_device_wheel_unlink(pos);
+  mesh_device_tree_remove(pos);
+  if (pos != last) {
+    node_list->index[mesh_device_index_slot(node_list->keys[last])] = pos+1;
+    node_list->keys[pos] = node_list->keys[last];
+    node_list->timestamps[pos] = node_list->timestamps[last];
+    mesh_device_tree_move(last, pos);
+
+    // Redirect the timing-wheel's references from the last position to the new
+    // one
+    link = &node_list->wheel_links[pos];
+    os_memcpy(link, &node_list->wheel_links[last], sizeof(struct mesh_device_wheel_link_type));
+    if (link->prev != MESH_DEVICE_INDEX_NONE) {
+      node_list->wheel_links[link->prev].next = pos;
+    }
+    else {
+      node_list->wheel[link->bucket] = pos;
+    }
+    if (link->next != MESH_DEVICE_INDEX_NONE) {
+      node_list->wheel_links[link->next].prev = pos;
+    }
+  }
+  node_list->entries_count--;
+}
+
+// Delete the node referenced by the given index-slot; if an iterator is open,
+// the node is only marked and removed when the last iterator is closed (cf.
+// mesh_device_node_apply)
+static void ICACHE_FLASH_ATTR mesh_device_node_delete(uint16_t slot) {
+  uint16_t pos = node_list->index[slot]-1;
+
+  if (!mesh_device_node_deferred(pos)) {
+    mesh_device_node_notify(pos, false);
+  }
+  if (node_list_iterators == 0) {
+    mesh_device_node_remove(slot);
+  }
+  else if (!mesh_device_node_deferred(pos)) {
+    node_list->deferred[pos >> 3] |= 1 << (pos & 7);
+    node_list->deferred_count++;
+  }
+}
+
+// Undo the deferred deletion of the node at the given position (e.g. if it is
+// added again, before the deletion has been applied)
+static void ICACHE_FLASH_ATTR mesh_device_node_restore(uint16_t pos) {
+  if (mesh_device_node_deferred(pos)) {
+    node_list->deferred[pos >> 3] &= ~(1 << (pos & 7));
+    node_list->deferred_count--;
+    mesh_device_node_notify(pos, true);
+  }
+}
+
+// Remove all nodes, whose deletion has been deferred; the list is traversed
+// backwards, so that the nodes moved into the places of the removed ones have
+// already been checked
+static void ICACHE_FLASH_ATTR mesh_device_node_apply(void) {
+  uint16_t pos = node_list->entries_count-1;
+
+  while (node_list->deferred_count > 0 && pos-- > 0) {
+    if (mesh_device_node_deferred(pos)) {
+      node_list->deferred[pos >> 3] &= ~(1 << (pos & 7));
+      node_list->deferred_count--;
+      mesh_device_node_remove(mesh_device_index_slot(node_list->keys[pos]));
+    }
+  }
+}
+
+/*------------------------------------*/
+
+// Allocate the given number of bytes from the heap and account for it in the
+// statistics; the only place where the device-list touches the heap
+static void * ICACHE_FLASH_ATTR mesh_device_zalloc(size_t size) {
+  void *buf = os_zalloc(size);
+
+  if (buf) {
+    node_list_stats.alloc_count++;
+  }
+  return buf;
+}
+
+// Determine the maximum number of nodes a mesh-network can consist of with the
+// given MAX_HOPS and MESH_DEVICE_FAN_OUT (cf. user_config.h)
+static uint16_t ICACHE_FLASH_ATTR mesh_device_list_capacity(void) {
+  uint32_t capacity = 0, layer_count = 1;
+  uint8_t layer = 0;
+
+  for (layer = 0; layer < MAX_HOPS && capacity <= MESH_DEVICE_CAPACITY_MAX; layer++) {
+    capacity += layer_count;
+    layer_count *= MESH_DEVICE_FAN_OUT;
+  }
+  if (capacity > MESH_DEVICE_CAPACITY_MAX) {
+    os_printf("mesh_device_list_capacity: MAX_HOPS and MESH_DEVICE_FAN_OUT exceed the maximum capacity! Limiting it to %d nodes!\n", MESH_DEVICE_CAPACITY_MAX);
+    capacity = MESH_DEVICE_CAPACITY_MAX;
+  }
+  return capacity;
+}
+
+// Reset the list of registered nodes (including the root) without releasing the
+// node-pool
+static void ICACHE_FLASH_ATTR mesh_device_list_reset(void) {
+  node_list->entries_count = 0;
+  os_memset(&node_list->root, 0, sizeof(struct mesh_device_node_type));
+  node_list->root_key = 0;
+  node_list->digest = 0;
+#if MESH_DEVICE_OUI_COMPRESSION
+  os_memset(node_list->oui, 0, sizeof(node_list->oui));
+#endif
+  os_memset(node_list->index, 0, node_list->index_size*sizeof(uint16_t));
+  os_memset(node_list->deferred, 0, (node_list->capacity+7)/8);
+  node_list->deferred_count = 0;
+  mesh_device_wheel_reset();
+  mesh_device_tree_reset();
+
+  // Invalidate all open iterators
+  node_list_generation++;
+  node_list_iterators = 0;
+}
+
+// Initialize the list containing the currently registered nodes; the node-pool
+// and the hash-index are allocated once with the maximum capacity, so that the
+// list doesn't have to touch the heap afterwards
 void ICACHE_FLASH_ATTR mesh_device_list_init(void) {
   if (!node_list) {
-    node_list = (struct mesh_device_list_type *) os_zalloc(sizeof(struct mesh_device_list_type));
+    node_list = (struct mesh_device_list_type *) mesh_device_zalloc(sizeof(struct mesh_device_list_type));
+    if (!node_list) {
+      os_printf("mesh_device_list_init: Allocating node_list failed!\n");
+      return;
+    }
+  }
+  if (!node_list->keys) {
+    uint32_t index_size = MESH_DEVICE_INDEX_SIZE_MIN;
+
+    node_list->capacity = mesh_device_list_capacity();
+    while (index_size < 2*(uint32_t) node_list->capacity) {
+      index_size <<= 1;
+    }
+    node_list->index_size = index_size;  // At most 2*MESH_DEVICE_CAPACITY_MAX
+    node_list->keys = (mesh_device_key_type *) mesh_device_zalloc(node_list->capacity*sizeof(mesh_device_key_type));
+    node_list->timestamps = (mesh_device_time_type *) mesh_device_zalloc(node_list->capacity*sizeof(mesh_device_time_type));
+    node_list->deferred = (uint8_t *) mesh_device_zalloc((node_list->capacity+7)/8);
+    node_list->index = (uint16_t *) mesh_device_zalloc(node_list->index_size*sizeof(uint16_t));
+    node_list->wheel_links = (struct mesh_device_wheel_link_type *) mesh_device_zalloc(node_list->capacity*sizeof(struct mesh_device_wheel_link_type));
+    node_list->tree = (struct mesh_device_tree_type *) mesh_device_zalloc(node_list->capacity*sizeof(struct mesh_device_tree_type));
+    if (!node_list->keys || !node_list->timestamps || !node_list->deferred || !node_list->index || !node_list->wheel_links || !node_list->tree) {
+      os_printf("mesh_device_list_init: Allocating the node-pool failed!\n");
+      mesh_device_list_release();
+      return;
+    }
+    node_list_stats.capacity = node_list->capacity;
+    mesh_device_wheel_reset();
+    mesh_device_tree_reset();
   }
 }
 
-// Free node_list->list and set node_list to zero
+// Free the node-pool as well as the hash-index, the timing-wheel, the routing-
+// tree and node_list itself
 void ICACHE_FLASH_ATTR mesh_device_list_release(void) {
   if (node_list) {
-    if (node_list->list) {
-      os_free(node_list->list);
-      node_list->list = NULL;
+    if (node_list->keys) {
+      os_free(node_list->keys);
+    }
+    if (node_list->timestamps) {
+      os_free(node_list->timestamps);
+    }
+    if (node_list->deferred) {
+      os_free(node_list->deferred);
+    }
+    if (node_list->index) {
+      os_free(node_list->index);
+    }
+    if (node_list->wheel_links) {
+      os_free(node_list->wheel_links);
+    }
+    if (node_list->tree) {
+      os_free(node_list->tree);
     }
-    os_memset(node_list, 0, sizeof(struct mesh_device_list_type));
+    os_free(node_list);
+    node_list = NULL;
+
+    // Invalidate all open iterators
+    node_list_generation++;
+    node_list_iterators = 0;
+
+    // The next list starts with the default timeout-threshold again
+    node_list_timeout = SUB_NODE_TIMEOUT_THRESHOLD;
   }
 }
 
+// Register a handler-function, which is notified whenever a node joins or
+// leaves the list (e.g. to propagate the changes to other nodes); NULL removes
+// the current one. Resets of the list (e.g. by a new root) aren't reported.
+void ICACHE_FLASH_ATTR mesh_device_change_handler_set(mesh_device_change_handler handler) {
+  node_list_change_handler = handler;
+}
+
+// Set the time, after which a non-responsive node is deleted from the list (in
+// ms), e.g. to a multiple of the interval of the topology-tests, which confirm
+// the registered nodes; it is never shorter than SUB_NODE_TIMEOUT_THRESHOLD.
+// A shortened timeout applies to the registered nodes at the latest after one
+// revolution of the timing-wheel.
+void ICACHE_FLASH_ATTR mesh_device_timeout_set(uint32_t timeout) {
+  node_list_timeout = timeout > SUB_NODE_TIMEOUT_THRESHOLD ? timeout : SUB_NODE_TIMEOUT_THRESHOLD;
+}
+
+// Return the usage-statistics of the device-list (e.g. to verify, that the heap
+// isn't touched after the initialization)
+void ICACHE_FLASH_ATTR mesh_device_stats_get(struct mesh_device_stats_type *stats) {
+  if (!stats) {
+    os_printf("mesh_device_stats_get: Invalid transfer parameter!\n");
+    return;
+  }
+
+  os_memcpy(stats, &node_list_stats, sizeof(struct mesh_device_stats_type));
+}
+
 // Print all registered nodes' MAC-adress to the serial port
 void ICACHE_FLASH_ATTR mesh_device_list_disp(void) {
   if (!node_list) {
@@ -67,17 +751,30 @@ void ICACHE_FLASH_ATTR mesh_device_list_disp(void) {
   }
 
   uint16_t idx = 0;
+  struct mesh_device_iter_type iter;
+  struct mesh_device_node_type node;
 
   os_printf("/*---------- registered nodes ----------*/\n");
   os_printf("(Root) MAC:      " MACSTR "\n", MAC2STR(node_list->root.mac_addr.mac));
-  for (idx = 0; idx < node_list->entries_count-1; idx++) {
+  mesh_device_iter_open(&iter);
+  for (idx = 0; mesh_device_iter_next(&iter, &node); idx++) {
     if (idx < 10) {
-      os_printf("(Index: %d) MAC:  " MACSTR "\n", idx, MAC2STR(node_list->list[idx].mac_addr.mac));
+      os_printf("(Index: %d) MAC:  " MACSTR "\n", idx, MAC2STR(node.mac_addr.mac));
     }
     else {
-      os_printf("(Index: %d) MAC: " MACSTR "\n", idx, MAC2STR(node_list->list[idx].mac_addr.mac));
+      os_printf("(Index: %d) MAC: " MACSTR "\n", idx, MAC2STR(node.mac_addr.mac));
     }
   }
+  mesh_device_iter_close(&iter);
+  os_printf("(Pool usage: %d/%d nodes, heap-allocations: %d)\n", mesh_device_list_count(), node_list->capacity, node_list_stats.alloc_count);
+#if MESH_DEVICE_OUI_COMPRESSION
+  // Compare the compressed form with the uncompressed one (packed MAC-address and
+  // system-time)
+  uint16_t node_size = sizeof(mesh_device_key_type)+sizeof(mesh_device_time_type);
+  uint16_t full_size = sizeof(uint64_t)+sizeof(uint32_t);
+
+  os_printf("(Node-size: %d instead of %d byte, saved: %d byte in total)\n", node_size, full_size, mesh_device_list_count()*(full_size-node_size));
+#endif
   os_printf("/*-------------- list end --------------*/\n");
 }
 
@@ -97,51 +794,102 @@ bool ICACHE_FLASH_ATTR mesh_device_list_search(struct mesh_device_mac_type *node
     return false;
   }
 
-  uint16_t idx = 0;
+  mesh_device_key_type key = mesh_device_key(node);
 
-  if (os_memcmp(&node_list->root.mac_addr, node, sizeof(struct mesh_device_mac_type)) == 0) { // Check the root-device
+  if (key == node_list->root_key) { // Check the root-device
     return true;
   }
-  for (idx = 0; idx < node_list->entries_count-1; idx++) {
-    if (os_memcmp(&node_list->list[idx].mac_addr, node, sizeof(struct mesh_device_mac_type)) == 0){  // Check every currently registered node
-      return true;
-    }
+  return mesh_device_index_lookup(key) != MESH_DEVICE_INDEX_NONE; // Check the currently registered nodes
+}
+
+// Return the number of currently registered nodes (excluding the root)
+uint16_t ICACHE_FLASH_ATTR mesh_device_list_count(void) {
+  if (!node_list || node_list->entries_count <= 1) {
+    return 0;
   }
-  return false;
+  return node_list->entries_count-1-node_list->deferred_count;
 }
 
-// Return the currently registered nodes as well as their number
-bool ICACHE_FLASH_ATTR mesh_device_list_get(const struct mesh_device_node_type **nodes, uint16_t *count) {
-  if (!nodes || !count) {
-    os_printf("mesh_device_list_get: Invalid transfer parameters!\n");
+// Return the version of the list: a hash over the set of currently registered
+// nodes (excluding the root), which is independent of their order and
+// maintained incrementally, so that two devices can cheaply check, whether
+// their lists match
+uint32_t ICACHE_FLASH_ATTR mesh_device_list_version(void) {
+  if (!node_list) {
+    return 0;
+  }
+  return node_list->digest;
+}
+
+// Open an iterator over the currently registered nodes (excluding the root);
+// while it is open, deletions are deferred, so that the list can be iterated in
+// place and even be modified by the reader (cf. mesh_device_node_delete); every
+// opened iterator has to be closed by mesh_device_iter_close
+bool ICACHE_FLASH_ATTR mesh_device_iter_open(struct mesh_device_iter_type *iter) {
+  if (!iter) {
+    os_printf("mesh_device_iter_open: Invalid transfer parameter!\n");
     return false;
   }
-  if (!node_list) {
-    os_printf("mesh_device_list_get: Please initialize node_list before trying to access it!\n");
+
+  iter->generation = node_list_generation;
+  iter->pos = 0;
+  iter->count = 0;
+  if (!node_list || node_list->entries_count <= 1) {  // Nothing to iterate; the iterator is nevertheless valid
+    return true;
+  }
+  iter->count = node_list->entries_count-1;
+  node_list_iterators++;
+  return true;
+}
+
+// Assemble the next registered node into the given struct; return false, if
+// all nodes have been visited or the iterator has been invalidated by a reset
+// of the list
+bool ICACHE_FLASH_ATTR mesh_device_iter_next(struct mesh_device_iter_type *iter, struct mesh_device_node_type *node) {
+  if (!iter || !node) {
+    os_printf("mesh_device_iter_next: Invalid transfer parameters!\n");
+    return false;
+  }
+  if (iter->generation != node_list_generation) {
     return false;
   }
 
-  if (node_list->entries_count <= 1 || !node_list->list) {  // Should both apply at the same time
-    os_printf("mesh_device_list_get: List is empty!\n");
-    *nodes = NULL;
-    *count = 0;
+  // Skip the nodes, whose deletion has been deferred
+  while (iter->pos < iter->count && mesh_device_node_deferred(iter->pos)) {
+    iter->pos++;
   }
-  else {
-    // As already mentioned above, this would be a possible implementation of a
-    // clean coupling/read-only without the usage of "const".
-    /* if (node_list_list_cpy) {
-     *  os_free(node_list_list_cpy);  // Free if already allocated
-     * }
-     * // Re-allocate node_list_list_cpy and copy node_list->list to it
-     * node_list_list_cpy = (struct mesh_device_node_type *) os_malloc((node_list->entries_count-1)*sizeof(struct mesh_device_node_type));
-     * if (!node_list_list_cpy) {
-     *  os_printf("mesh_device_get_mac_list: Re-allocating node_list_list_cpy failed!\n");
-     * }
-     * os_memcpy(node_list_list_cpy, node_list->list, (node_list->entries_count-1)*sizeof(struct mesh_device_node_type));
-     * *nodes = node_list_list_cpy;  // Set the reference of nodes to node_list_list_cpy (so node_list->list stays hidden and can't be manipulated from the outside)
-     */
-    *nodes = node_list->list;
-    *count = node_list->entries_count-1;
+  if (iter->pos >= iter->count) {
+    return false;
+  }
+
+  mesh_device_key_mac(node_list->keys[iter->pos], &node->mac_addr);
+#if MESH_DEVICE_OUI_COMPRESSION
+  node->timestamp = system_get_time()-mesh_device_age(mesh_device_time(), node_list->timestamps[iter->pos])*1000; // Convert it back to system-time
+#else
+  node->timestamp = node_list->timestamps[iter->pos];
+#endif
+  iter->pos++;
+  return true;
+}
+
+// Close the given iterator; the deferred deletions are applied, when the last
+// open iterator is closed; return false, if the list has been reset in the
+// meantime (so the iterated nodes didn't represent a consistent state)
+bool ICACHE_FLASH_ATTR mesh_device_iter_close(struct mesh_device_iter_type *iter) {
+  if (!iter) {
+    os_printf("mesh_device_iter_close: Invalid transfer parameter!\n");
+    return false;
+  }
+  if (iter->generation != node_list_generation) {
+    os_printf("mesh_device_iter_close: List has been reset during the iteration!\n");
+    return false;
+  }
+
+  if (iter->count > 0) {  // Otherwise it hasn't been counted as open (or has already been closed)
+    iter->count = 0;
+    if (--node_list_iterators == 0) {
+      mesh_device_node_apply();
+    }
   }
   return true;
 }
@@ -154,20 +902,30 @@ bool ICACHE_FLASH_ATTR mesh_device_root_set(struct mesh_device_mac_type *root) {
   }
 
   // Check whether node_list has been initialized yet and initialize it if not
-  if (!node_list) {
+  if (!node_list || !node_list->keys) {
     mesh_device_list_init();
+    if (!node_list || !node_list->keys) {
+      os_printf("mesh_device_root_set: Failed to initialize node_list!\n");
+      return false;
+    }
   }
 
   if (node_list->entries_count <= 0) { // Check if there currently is a root
     os_printf("mesh_device_root_set: Setting new root: " MACSTR "\n", MAC2STR(root->mac));
-    mesh_device_list_release(); // Clean reset in case some kind of distortion of the data occured; not directly necessary here, just a safety measure
+    mesh_device_list_reset(); // Clean reset in case some kind of distortion of the data occured; not directly necessary here, just a safety measure
     os_memcpy(&node_list->root.mac_addr, root, sizeof(struct mesh_device_mac_type));
+    node_list->root_key = mesh_device_key_add(root);
+    mesh_device_key_ref(node_list->root_key, 1);
+    node_list->root.timestamp = system_get_time();
     node_list->entries_count = 1;
   }
   else if (os_memcmp(&node_list->root.mac_addr, root, sizeof(struct mesh_device_mac_type)) != 0){  // Current root is NOT the same as the given MAC-adress
     os_printf("mesh_device_root_set: Switching root from: " MACSTR " to: " MACSTR "\n", MAC2STR(node_list->root.mac_addr.mac), MAC2STR(root->mac));
-    mesh_device_list_release(); // Release the current list of registered nodes (since they belonged to the old root-device)
+    mesh_device_list_reset(); // Reset the current list of registered nodes (since they belonged to the old root-device)
     os_memcpy(&node_list->root.mac_addr, root, sizeof(struct mesh_device_mac_type));
+    node_list->root_key = mesh_device_key_add(root);
+    mesh_device_key_ref(node_list->root_key, 1);
+    node_list->root.timestamp = system_get_time();
     node_list->entries_count = 1; // Since the old list of registered nodes has been released, the only existing entry is that of the root-device.
   }
   if (os_memcmp(&node_list->root.mac_addr, root, sizeof(struct mesh_device_mac_type)) == 0) {
@@ -212,7 +970,7 @@ bool ICACHE_FLASH_ATTR mesh_device_root_get(const struct mesh_device_node_type *
 // true if all the devices timestamp could be updated and false if not (nodes
 // not yet registered are not considered)
 bool ICACHE_FLASH_ATTR mesh_device_update_timestamp(struct mesh_device_mac_type *nodes, uint16_t count) {
-  if (!nodes || count < 0) {
+  if (!nodes) {
     os_printf("mesh_device_update_timestamp: Invalid transfer parameter!\n");
     return false;
   }
@@ -225,29 +983,55 @@ bool ICACHE_FLASH_ATTR mesh_device_update_timestamp(struct mesh_device_mac_type
     return false;
   }
 
-  uint16_t update_nodes_idx = 0, idx = 0;
+  uint16_t update_nodes_idx = 0, pos = 0;
+  uint32_t timestamp = system_get_time();
+  mesh_device_time_type node_timestamp = mesh_device_time();
+  mesh_device_key_type key = 0;
 
-  while(update_nodes_idx < count) {
-    // Skip nodes that are not included in the list and possible nullpointers
-    if (&nodes[update_nodes_idx] && mesh_device_list_search(&nodes[update_nodes_idx])) {
-      if (os_memcmp(&node_list->root.mac_addr, &nodes[update_nodes_idx], sizeof(struct mesh_device_mac_type)) == 0) { // Check the root-device
-        node_list->root.timestamp = system_get_time();
-      }
-      for (idx = 0; idx < node_list->entries_count-1; idx++) {
-        if (os_memcmp(&node_list->list[idx].mac_addr, &nodes[update_nodes_idx], sizeof(struct mesh_device_mac_type)) == 0){  // Check every currently registered node
-          node_list->list[idx].timestamp = system_get_time();
-          break;
-        }
-      }
+  for (update_nodes_idx = 0; update_nodes_idx < count; update_nodes_idx++) {
+    key = mesh_device_key(&nodes[update_nodes_idx]);
+    if (key == node_list->root_key) { // Check the root-device
+      node_list->root.timestamp = timestamp;
+      continue;
+    }
+    // Skip nodes that are not included in the list
+    pos = mesh_device_index_lookup(key);
+    if (pos != MESH_DEVICE_INDEX_NONE) {
+      mesh_device_node_refresh(pos, node_timestamp, true);
     }
-    update_nodes_idx++;
   }
   return true;
 }
 
-// Re-allocate node_list->list and add a number of nodes
+// Update the timestamp of the root and of all registered nodes to the current
+// system-time, e.g. when the root has confirmed the whole device-list (cf.
+// mesh_topology_delta_apply)
+bool ICACHE_FLASH_ATTR mesh_device_refresh(void) {
+  if (!node_list || !node_list->keys) {
+    os_printf("mesh_device_refresh: Please initialize node_list before trying to access it!\n");
+    return false;
+  }
+  if (node_list->entries_count <= 0) {
+    os_printf("mesh_device_refresh: List is empty!\n");
+    return false;
+  }
+
+  uint16_t pos = 0;
+  mesh_device_time_type timestamp = mesh_device_time();
+
+  node_list->root.timestamp = system_get_time();
+  for (pos = 0; pos < node_list->entries_count-1; pos++) {
+    if (!mesh_device_node_deferred(pos)) {
+      mesh_device_node_refresh(pos, timestamp, true);
+    }
+  }
+  return true;
+}
+
+// Add a number of nodes to the node-pool; return false, if not all of them fit
+// into it
 bool ICACHE_FLASH_ATTR mesh_device_add(struct mesh_device_mac_type *nodes, uint16_t count) {
-  if (!nodes || count < 0) {
+  if (!nodes) {
     os_printf("mesh_device_add: Invalid transfer parameters!\n");
     return false;
   }
@@ -260,54 +1044,83 @@ bool ICACHE_FLASH_ATTR mesh_device_add(struct mesh_device_mac_type *nodes, uint1
     return false;
   }
 
-  if (count > 0) {  // Only do stuff if count is bigger than zero
-    uint16_t new_nodes_count_idx = 0, new_nodes_count = 0, idx = 0;
-    struct mesh_device_node_type *buf = NULL;
+  uint16_t idx = 0, slot = 0, overflow_count = 0;
+  mesh_device_time_type timestamp = mesh_device_time();
+  mesh_device_key_type key = 0;
 
-    // Determine the number of new (not yet registered) nodes
-    while (new_nodes_count_idx < count) {
-      if (&nodes[new_nodes_count_idx] && !mesh_device_list_search(&nodes[new_nodes_count_idx])) {
-        new_nodes_count++;
-      }
-      new_nodes_count_idx++;
+  for (idx = 0; idx < count; idx++) {
+    // Skip nodes that are already included in the list
+    key = mesh_device_key_add(&nodes[idx]);
+    if (key == node_list->root_key) {
+      continue;
     }
-
-    // Only do stuff, if there are new nodes to add in the transfer parameters
-    if (new_nodes_count > 0) {
-      // Re-allocate node_list->list to match the new number of registered nodes
-      buf = (struct mesh_device_node_type *) os_zalloc((node_list->entries_count-1+new_nodes_count)*sizeof(struct mesh_device_node_type));
-      if (!buf) {
-        os_printf("mesh_device_add: Re-allocating node_list->list failed!\n");
-        return false;
-      }
-      if (node_list->list) {
-        // Move the content of node_list->list to buf
-        if (node_list->entries_count > 1) {
-          os_memcpy(buf, node_list->list, (node_list->entries_count-1)*sizeof(struct mesh_device_node_type));
-        }
-        os_free(node_list->list);  // Free the (now redundant) old list
-      }
-      node_list->list = buf; // Set the reference of node_list->list to buf
-
-      // Add the new nodes to node_list->list
-      while (idx < count) {
-        // Skip nodes that are already included in the list and possible
-        // nullpointers
-        if (&nodes[idx] && !mesh_device_list_search(&nodes[idx])) {
-          os_memcpy(&node_list->list[node_list->entries_count-1].mac_addr, &nodes[idx], sizeof(struct mesh_device_mac_type));
-          node_list->entries_count++;
-        }
-        idx++;
+    slot = mesh_device_index_slot(key);
+    if (node_list->index[slot]) {
+      if (mesh_device_node_deferred(node_list->index[slot]-1)) {  // Deleted during an iteration; add it again
+        mesh_device_node_restore(node_list->index[slot]-1);
+        mesh_device_node_refresh(node_list->index[slot]-1, timestamp, true);
       }
     }
+    else if (!mesh_device_node_insert(slot, key, timestamp)) {  // Node-pool (or OUI-dictionary) is exhausted
+      overflow_count++;
+    }
+  }
+
+  if (overflow_count > 0) {
+    os_printf("mesh_device_add: List is full! Dropped %d nodes!\n", overflow_count);
+    return false;
+  }
+  return true;
+}
+
+// Add a node, which has last been seen the given time ago (in ms), e.g. when
+// the list is restored from a snapshot (cf. mesh_device_flash.c); its expiry-
+// deadline is shortened accordingly and nodes already registered are skipped
+bool ICACHE_FLASH_ATTR mesh_device_add_aged(struct mesh_device_mac_type *node, uint32_t age) {
+  if (!node) {
+    os_printf("mesh_device_add_aged: Invalid transfer parameter!\n");
+    return false;
+  }
+  if (!node_list) {
+    os_printf("mesh_device_add_aged: Please initialize node_list before trying to access it!\n");
+    return false;
+  }
+  if (node_list->entries_count < 1) {
+    os_printf("mesh_device_add_aged: No current root! Can't add nodes!\n");
+    return false;
+  }
+  if (age > node_list_timeout) { // Would be deleted by the next expiry anyway
+    return true;
   }
+
+  mesh_device_key_type key = mesh_device_key_add(node);
+  uint16_t slot = 0;
+
+  if (key == node_list->root_key) {
+    return true;
+  }
+  slot = mesh_device_index_slot(key);
+  if (node_list->index[slot]) {
+    return true;
+  }
+#if MESH_DEVICE_OUI_COMPRESSION
+  if (!mesh_device_node_insert(slot, key, mesh_device_time()-(mesh_device_time_type) (age/1000))) {
+#else
+  if (!mesh_device_node_insert(slot, key, system_get_time()-age*1000)) {
+#endif
+    os_printf("mesh_device_add_aged: List is full! Dropped 1 node!\n");
+    return false;
+  }
+
+  // Re-link it into the bucket of its actual deadline
+  mesh_device_wheel_unlink(node_list->entries_count-2);
+  mesh_device_wheel_link(node_list->entries_count-2, (mesh_device_clock()+node_list_timeout-age)/MESH_DEVICE_WHEEL_TICK);
   return true;
 }
 
-// Deletes a number of nodes from the list of currently registered nodes and
-// re-allocate node_list->list
+// Deletes a number of nodes from the list of currently registered nodes
 bool ICACHE_FLASH_ATTR mesh_device_del(struct mesh_device_mac_type *nodes, uint16_t count) {
-  if (!nodes || count <= 0) { // Nothing to do if nodes == NULL or count <= 0; return true (since node_list->list doesn't contain the given node either way)
+  if (!nodes || count <= 0) { // Nothing to do if nodes == NULL or count <= 0; return true (since the registry doesn't contain the given node either way)
     os_printf("mesh_device_del: Warning: nodes == NULL or count <= 0!\n");
     return true;
   }
@@ -320,47 +1133,317 @@ bool ICACHE_FLASH_ATTR mesh_device_del(struct mesh_device_mac_type *nodes, uint1
     return true;
   }
 
-  uint16_t redundant_nodes_idx = 0, idx = 0;
-  uint16_t entries_count_cpy = node_list->entries_count;
-  struct mesh_device_node_type *buf = NULL;
+  uint16_t redundant_nodes_idx = 0, slot = 0;
+  mesh_device_key_type key = 0;
 
-  while (redundant_nodes_idx < count) {
-    // Skip nodes that are not included in the list and possible nullpointers
-    if (&nodes[redundant_nodes_idx] && mesh_device_list_search(&nodes[redundant_nodes_idx])) {
-      // Check if the current to-delete-node is the root device
-      if (os_memcmp(&node_list->root.mac_addr, &nodes[redundant_nodes_idx], sizeof(struct mesh_device_mac_type) == 0)) {
-        mesh_device_list_release(); // node_list->list has to be reset as well if the root-device is deleted
-        return true;
-      }
-      // Check every currently registered node
-      for (idx = 0; idx < node_list->entries_count-1; idx++) {
-        if (os_memcmp(&node_list->list[idx].mac_addr, &nodes[redundant_nodes_idx], sizeof(struct mesh_device_mac_type)) == 0) {
-          if (idx < node_list->entries_count-2) {  // Is the to-delete-node the last node in the list?
-            // "Delete" the to-delete-node through moving every further node that
-            // comes afterwards in the list one place to the front
-            os_memcpy(&node_list->list[idx], &node_list->list[idx+1], (node_list->entries_count-1-(idx+1))*sizeof(struct mesh_device_node_type));
+  for (redundant_nodes_idx = 0; redundant_nodes_idx < count; redundant_nodes_idx++) {
+    // Check if the current to-delete-node is the root device
+    key = mesh_device_key(&nodes[redundant_nodes_idx]);
+    if (key == node_list->root_key) {
+      mesh_device_list_reset(); // The registered nodes have to be reset as well if the root-device is deleted
+      return true;
+    }
+    // Skip nodes that are not included in the list
+    if (node_list->entries_count <= 1) {
+      break;
+    }
+    slot = mesh_device_index_slot(key);
+    if (node_list->index[slot]) {
+      mesh_device_node_delete(slot);
+    }
+  }
+
+  return true;
+}
+
+// Start the reconciliation of the device-list with a topology-snapshot: set the
+// root-device and update its timestamp; the nodes of the snapshot are passed
+// to mesh_device_sync_nodes afterwards (possibly in several parts, e.g. one per
+// option of a topology-response) and the reconciliation is completed by
+// mesh_device_sync_end
+bool ICACHE_FLASH_ATTR mesh_device_sync_begin(struct mesh_device_mac_type *root) {
+  if (!root) {
+    os_printf("mesh_device_sync_begin: Invalid transfer parameter!\n");
+    return false;
+  }
+  if (!mesh_device_root_set(root)) {
+    os_printf("mesh_device_sync_begin: Failed to set the root-device!\n");
+    node_list_sync_running = false;
+    return false;
+  }
+
+  node_list->root.timestamp = system_get_time();
+  os_memset(&node_list_sync, 0, sizeof(struct mesh_device_sync_type));
+  node_list_sync_running = true;
+  return true;
+}
+
+// Apply a part of the topology-snapshot to the device-list in a single pass:
+// newly registered nodes are added and the timestamp of already registered
+// nodes is updated
+bool ICACHE_FLASH_ATTR mesh_device_sync_nodes(struct mesh_device_mac_type *nodes, uint16_t count) {
+  if (!nodes && count > 0) {
+    os_printf("mesh_device_sync_nodes: Invalid transfer parameters!\n");
+    return false;
+  }
+  if (!node_list_sync_running || !node_list) {
+    os_printf("mesh_device_sync_nodes: Please call mesh_device_sync_begin first!\n");
+    return false;
+  }
+
+  uint16_t idx = 0, slot = 0, overflow_count = 0;
+  mesh_device_time_type timestamp = mesh_device_time();
+  mesh_device_key_type key = 0;
+
+  for (idx = 0; idx < count; idx++) {
+    key = mesh_device_key_add(&nodes[idx]);
+    if (key == node_list->root_key) { // The root-device has already been updated
+      continue;
+    }
+    slot = mesh_device_index_slot(key);
+    if (node_list->index[slot] && mesh_device_node_deferred(node_list->index[slot]-1)) {  // Deleted during an iteration; add it again
+      mesh_device_node_restore(node_list->index[slot]-1);
+      mesh_device_node_refresh(node_list->index[slot]-1, timestamp, true);
+      node_list_sync.added++;
+    }
+    else if (node_list->index[slot]) { // Already registered; refresh its timestamp
+      mesh_device_node_refresh(node_list->index[slot]-1, timestamp, true);
+      node_list_sync.refreshed++;
+    }
+    else if (mesh_device_node_insert(slot, key, timestamp)) {
+      node_list_sync.added++;
+    }
+    else {  // Node-pool (or OUI-dictionary) is exhausted
+      overflow_count++;
+    }
+  }
+
+  if (overflow_count > 0) {
+    os_printf("mesh_device_sync_nodes: List is full! Dropped %d nodes!\n", overflow_count);
+    return false;
+  }
+  return true;
+}
+
+// Delete all nodes whose timestamp exceeds the defined timeout-threshold (cf.
+// mesh_device_timeout_set) and return their number; only the buckets of the
+// timing-wheel, whose ticks have passed since the last call, are visited, so
+// the effort is proportional to the number of nodes that actually expire
+uint16_t ICACHE_FLASH_ATTR mesh_device_expire(void) {
+  if (!node_list || !node_list->keys) {
+    os_printf("mesh_device_expire: Please initialize node_list before trying to access it!\n");
+    return 0;
+  }
+
+  uint32_t clock = mesh_device_clock();
+  mesh_device_time_type timestamp = mesh_device_time();
+  uint32_t tick = clock/MESH_DEVICE_WHEEL_TICK, deadline_tick = 0;
+  uint32_t ticks = tick-node_list->wheel_tick+1;
+  uint16_t pos = 0, next = 0, removed = 0;
+  uint8_t bucket = 0;
+
+  if (ticks > MESH_DEVICE_WHEEL_SLOTS) {  // More than one revolution has passed; every bucket has to be visited once
+    ticks = MESH_DEVICE_WHEEL_SLOTS;
+  }
+
+  while (ticks-- > 0) {
+    bucket = (tick-ticks) & (MESH_DEVICE_WHEEL_SLOTS-1);
+    pos = node_list->wheel[bucket];
+    while (pos != MESH_DEVICE_INDEX_NONE) {
+      next = node_list->wheel_links[pos].next;
+      if (mesh_device_age(timestamp, node_list->timestamps[pos]) > node_list_timeout) {
+        if (node_list_iterators > 0) {  // Only mark it; it is removed once the iterators are closed (cf. mesh_device_node_delete)
+          if (!mesh_device_node_deferred(pos)) {
+            mesh_device_node_delete(mesh_device_index_slot(node_list->keys[pos]));
+            removed++;
           }
-          node_list->entries_count--;
-          break;
+          pos = next;
+          continue;
+        }
+        if (next == node_list->entries_count-2) { // The next node is about to be moved into the place of the removed one
+          next = pos;
         }
+        mesh_device_node_notify(pos, false);
+        mesh_device_node_remove(mesh_device_index_slot(node_list->keys[pos]));
+        removed++;
       }
-      redundant_nodes_idx++;
+      else {
+        // Not yet expired (rounding of the deadline, the wheel has fallen
+        // behind by more than half a revolution or the deadline lies beyond
+        // one revolution); re-link it into the bucket of its actual deadline
+        deadline_tick = (clock+node_list_timeout-mesh_device_age(timestamp, node_list->timestamps[pos]))/MESH_DEVICE_WHEEL_TICK;
+        if ((deadline_tick & (MESH_DEVICE_WHEEL_SLOTS-1)) != bucket) {
+          mesh_device_wheel_unlink(pos);
+          mesh_device_wheel_link(pos, deadline_tick);
+        }
+      }
+      pos = next;
+    }
+  }
+  node_list->wheel_tick = tick;  // The current tick is visited again, since its deadlines may not have passed yet
+  return removed;
+}
+
+// Return the position of the given node in the routing-tree (the root is
+// MESH_DEVICE_INDEX_ROOT) or MESH_DEVICE_INDEX_NONE, if it isn't registered
+static uint16_t ICACHE_FLASH_ATTR mesh_device_tree_lookup(struct mesh_device_mac_type *node) {
+  mesh_device_key_type key = mesh_device_key(node);
+
+  if (node_list->entries_count <= 0) {
+    return MESH_DEVICE_INDEX_NONE;
+  }
+  return key == node_list->root_key ? MESH_DEVICE_INDEX_ROOT : mesh_device_index_lookup(key);
+}
+
+// Set the parent of the given node in the routing-tree (e.g. as reported by the
+// node itself); the node takes its subtree along. Return false, if one of them
+// isn't registered (yet) or the link would create a cycle
+bool ICACHE_FLASH_ATTR mesh_device_link(struct mesh_device_mac_type *node, struct mesh_device_mac_type *parent) {
+  if (!node || !parent) {
+    os_printf("mesh_device_link: Invalid transfer parameters!\n");
+    return false;
+  }
+  if (!node_list) {
+    os_printf("mesh_device_link: Please initialize node_list before trying to access it!\n");
+    return false;
+  }
+
+  uint16_t pos = mesh_device_tree_lookup(node), parent_pos = mesh_device_tree_lookup(parent), ancestor = parent_pos;
+
+  if (pos == MESH_DEVICE_INDEX_NONE || pos == MESH_DEVICE_INDEX_ROOT || parent_pos == MESH_DEVICE_INDEX_NONE) {
+    return false;
+  }
+  if (node_list->tree[pos].parent == parent_pos) { // Unchanged
+    return true;
+  }
+  // Check, that the new parent isn't part of the node's subtree
+  while (ancestor != MESH_DEVICE_INDEX_NONE && ancestor != MESH_DEVICE_INDEX_ROOT) {
+    if (ancestor == pos) {
+      os_printf("mesh_device_link: Linking " MACSTR " to " MACSTR " would create a cycle!\n", MAC2STR(node->mac), MAC2STR(parent->mac));
+      return false;
     }
+    ancestor = node_list->tree[ancestor].parent;
+  }
+
+  mesh_device_tree_unlink(pos);
+  mesh_device_tree_link(pos, parent_pos);
+  mesh_device_tree_redepth(pos);
+  return true;
+}
+
+// Return the parent of the given node in the routing-tree; return false, if it
+// isn't known
+bool ICACHE_FLASH_ATTR mesh_device_parent_get(struct mesh_device_mac_type *node, struct mesh_device_mac_type *parent) {
+  if (!node || !parent) {
+    os_printf("mesh_device_parent_get: Invalid transfer parameters!\n");
+    return false;
+  }
+  if (!node_list) {
+    os_printf("mesh_device_parent_get: Please initialize node_list before trying to access it!\n");
+    return false;
+  }
+
+  uint16_t pos = mesh_device_tree_lookup(node);
+
+  if (pos == MESH_DEVICE_INDEX_NONE || pos == MESH_DEVICE_INDEX_ROOT || node_list->tree[pos].parent == MESH_DEVICE_INDEX_NONE) {
+    return false;
+  }
+  if (node_list->tree[pos].parent == MESH_DEVICE_INDEX_ROOT) {
+    os_memcpy(parent, &node_list->root.mac_addr, sizeof(struct mesh_device_mac_type));
+  }
+  else {
+    mesh_device_key_mac(node_list->keys[node_list->tree[pos].parent], parent);
+  }
+  return true;
+}
+
+// Return the mesh-layer of the given node relative to the root (root = 0) or
+// MESH_DEVICE_DEPTH_UNKNOWN, if it isn't registered or its path to the root
+// isn't known
+uint8_t ICACHE_FLASH_ATTR mesh_device_depth_get(struct mesh_device_mac_type *node) {
+  if (!node || !node_list) {
+    return MESH_DEVICE_DEPTH_UNKNOWN;
+  }
+
+  uint16_t pos = mesh_device_tree_lookup(node);
+
+  return pos == MESH_DEVICE_INDEX_NONE ? MESH_DEVICE_DEPTH_UNKNOWN : mesh_device_tree_depth(pos);
+}
+
+// Return the number of nodes below the given node in the routing-tree (e.g. all
+// nodes, that are reached via the given relay); nodes, whose deletion has been
+// deferred, are still part of the tree, but aren't counted (like in mesh_
+// device_subtree_get)
+uint16_t ICACHE_FLASH_ATTR mesh_device_subtree_count(struct mesh_device_mac_type *node) {
+  if (!node || !node_list) {
+    return 0;
   }
 
-  // Re-allocate node_list->list to match the new number of registered nodes if
-  // at least one node was deleted
-  if (node_list->entries_count != entries_count_cpy) {
-    if (node_list->entries_count > 1) {
-      buf = (struct mesh_device_node_type *) os_zalloc((node_list->entries_count-1)*sizeof(struct mesh_device_node_type));
-      if (!buf) {
-        os_printf("mesh_device_del: Re-allocating node_list->list failed!\n");
-        return false;
+  uint16_t top = mesh_device_tree_lookup(node), pos = top, count = 0;
+
+  if (top == MESH_DEVICE_INDEX_NONE) {
+    return 0;
+  }
+  count = (top == MESH_DEVICE_INDEX_ROOT ? node_list->root_size : node_list->tree[top].size)-1;
+  if (node_list->deferred_count > 0) {
+    while ((pos = mesh_device_tree_next(top, pos)) != MESH_DEVICE_INDEX_NONE) {
+      if (mesh_device_node_deferred(pos)) {
+        count--;
       }
-      os_memcpy(buf, node_list->list, (node_list->entries_count-1)*sizeof(struct mesh_device_node_type));
     }
-    os_free(node_list->list);  // Free the (now redundant) old list
-    node_list->list = buf; // Set the reference of node_list->list to buf
+  }
+  return count;
+}
+
+// Copy the MAC-addresses of the nodes below the given node in the routing-tree
+// (parents before their children) to the given array of the given size and
+// return their number
+uint16_t ICACHE_FLASH_ATTR mesh_device_subtree_get(struct mesh_device_mac_type *node, struct mesh_device_mac_type *nodes, uint16_t count) {
+  if (!node || (!nodes && count > 0)) {
+    os_printf("mesh_device_subtree_get: Invalid transfer parameters!\n");
+    return 0;
+  }
+  if (!node_list) {
+    os_printf("mesh_device_subtree_get: Please initialize node_list before trying to access it!\n");
+    return 0;
+  }
+
+  uint16_t top = mesh_device_tree_lookup(node), pos = top, idx = 0;
+
+  if (top == MESH_DEVICE_INDEX_NONE) {
+    return 0;
+  }
+  while (idx < count && (pos = mesh_device_tree_next(top, pos)) != MESH_DEVICE_INDEX_NONE) {
+    if (!mesh_device_node_deferred(pos)) {
+      mesh_device_key_mac(node_list->keys[pos], &nodes[idx++]);
+    }
+  }
+  return idx;
+}
+
+// Complete the reconciliation: delete all nodes whose timestamp exceeds the
+// defined timeout-threshold (cf. mesh_device_expire) and return the summary of
+// the changes
+bool ICACHE_FLASH_ATTR mesh_device_sync_end(struct mesh_device_sync_type *result) {
+  if (!node_list_sync_running || !node_list) {
+    os_printf("mesh_device_sync_end: Please call mesh_device_sync_begin first!\n");
+    return false;
+  }
+
+  node_list_sync.removed = mesh_device_expire();
+  node_list_sync_running = false;
+  if (result) {
+    os_memcpy(result, &node_list_sync, sizeof(struct mesh_device_sync_type));
   }
   return true;
 }
+
+// Reconcile the device-list with the given topology-snapshot (root-device and
+// all currently connected nodes) in a single call; cf. mesh_device_sync_begin
+bool ICACHE_FLASH_ATTR mesh_device_sync(struct mesh_device_mac_type *root, struct mesh_device_mac_type *nodes, uint16_t count, struct mesh_device_sync_type *result) {
+  if (!mesh_device_sync_begin(root)) {
+    return false;
+  }
+  mesh_device_sync_nodes(nodes, count); // Dropped nodes have already been reported; expire the others nevertheless
+  return mesh_device_sync_end(result);
+}
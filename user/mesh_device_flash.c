@@ -0,0 +1,282 @@
+// mesh_device_flash.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: This class persists the list of registered nodes (cf.
+// mesh_device.c) in flash, so that it can be restored after a restart and
+// P2P-communication is possible right away, instead of only after the list has
+// been rebuilt by several topology-tests.
+//
+// The snapshots are written alternately to the two sectors directly below the
+// rf-calibration-sector (cf. user_rf_cal_sector_set): the sector of the older
+// snapshot is erased and overwritten, so that the current snapshot survives a
+// power-loss during the write and both sectors wear equally. The header, which
+// contains the sequence-number and the checksum, is written last, so that an
+// incomplete snapshot is never considered valid. To spare the flash, snapshots
+// are only written if the registered nodes have changed and at most once per
+// MESH_DEVICE_FLASH_SAVE_INTERVAL.
+
+#include "mem.h"
+#include "osapi.h"
+#include "user_interface.h"
+#include "spi_flash.h"
+#include "mesh_device.h"
+#include "mesh_device_flash.h"
+#include "user_config.h"
+
+// Number of nodes, which are read from or written to flash at once
+#define MESH_DEVICE_FLASH_CHUNK 16
+
+// Maximum number of nodes, that fit into a sector
+#define MESH_DEVICE_FLASH_NODES_MAX ((SPI_FLASH_SEC_SIZE-sizeof(struct mesh_device_flash_header_type))/sizeof(struct mesh_device_flash_node_type))
+
+// Initial value of the FNV-1a-hash
+#define MESH_DEVICE_FLASH_HASH_INIT 2166136261u
+
+uint32 user_rf_cal_sector_set(void); // Cf. esp_mesh.c
+
+static bool flash_found = false;        // Whether the current snapshot has been searched for yet
+static uint16_t flash_sector = 0;       // Sector of the current snapshot (0 = no valid snapshot)
+static uint32_t flash_seq = 0;          // Sequence-number of the current snapshot
+static uint32_t flash_nodes_hash = 0;   // Hash over the root and the nodes of the current snapshot
+static uint32_t flash_check_time = 0;   // System-time of the last check, whether a snapshot has to be written
+static bool flash_check_time_valid = false;
+
+/*------------------------------------*/
+
+// Continue the FNV-1a-hash over the given data
+static uint32_t ICACHE_FLASH_ATTR mesh_device_flash_hash(uint32_t hash, const void *data, uint16_t len) {
+  const uint8_t *byte = (const uint8_t *) data;
+
+  while (len-- > 0) {
+    hash ^= *byte++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Return the first of the two sectors holding the snapshots or 0, if the
+// flash-map is unknown
+static uint16_t ICACHE_FLASH_ATTR mesh_device_flash_base(void) {
+  uint32 rf_cal_sec = user_rf_cal_sector_set();
+
+  return rf_cal_sec > 2 ? rf_cal_sec-2 : 0;
+}
+
+// Read the header of the snapshot in the given sector and verify the snapshot's
+// checksum; return false, if it is incomplete or corrupted
+static bool ICACHE_FLASH_ATTR mesh_device_flash_check(uint16_t sector, struct mesh_device_flash_header_type *header) {
+  uint32_t buf[MESH_DEVICE_FLASH_CHUNK*sizeof(struct mesh_device_flash_node_type)/sizeof(uint32_t)];
+  uint32_t addr = sector*SPI_FLASH_SEC_SIZE+sizeof(struct mesh_device_flash_header_type), hash = MESH_DEVICE_FLASH_HASH_INIT;
+  uint16_t idx = 0, chunk = 0;
+
+  if (spi_flash_read(sector*SPI_FLASH_SEC_SIZE, (uint32 *) header, sizeof(struct mesh_device_flash_header_type)) != SPI_FLASH_RESULT_OK) {
+    return false;
+  }
+  if (header->magic != MESH_DEVICE_FLASH_MAGIC || header->count > MESH_DEVICE_FLASH_NODES_MAX) {
+    return false;
+  }
+
+  for (idx = 0; idx < header->count; idx += chunk) {
+    chunk = header->count-idx < MESH_DEVICE_FLASH_CHUNK ? header->count-idx : MESH_DEVICE_FLASH_CHUNK;
+    if (spi_flash_read(addr+idx*sizeof(struct mesh_device_flash_node_type), (uint32 *) buf, chunk*sizeof(struct mesh_device_flash_node_type)) != SPI_FLASH_RESULT_OK) {
+      return false;
+    }
+    hash = mesh_device_flash_hash(hash, buf, chunk*sizeof(struct mesh_device_flash_node_type));
+  }
+  hash = mesh_device_flash_hash(hash, &header->seq, sizeof(header->seq));
+  hash = mesh_device_flash_hash(hash, &header->count, sizeof(header->count)+sizeof(header->root));
+  return hash == header->checksum;
+}
+
+// Search both sectors for the current snapshot (the valid one with the highest
+// sequence-number) and return its header; return false, if there is none
+static bool ICACHE_FLASH_ATTR mesh_device_flash_find(uint16_t base, struct mesh_device_flash_header_type *header) {
+  struct mesh_device_flash_header_type other;
+  bool valid = mesh_device_flash_check(base, header), other_valid = mesh_device_flash_check(base+1, &other);
+
+  flash_found = true;
+  if (other_valid && (!valid || (int32_t) (other.seq-header->seq) > 0)) { // Compare the sequence-numbers overflow-safe
+    os_memcpy(header, &other, sizeof(struct mesh_device_flash_header_type));
+    flash_sector = base+1;
+  }
+  else if (valid) {
+    flash_sector = base;
+  }
+  else {
+    flash_sector = 0;
+    return false;
+  }
+  flash_seq = header->seq;
+  return true;
+}
+
+// Calculate a hash over the root and the currently registered nodes, which
+// doesn't depend on the order of the nodes (to detect changes cheaply)
+static uint32_t ICACHE_FLASH_ATTR mesh_device_flash_nodes_hash(const struct mesh_device_node_type *root) {
+  uint32_t hash = mesh_device_flash_hash(MESH_DEVICE_FLASH_HASH_INIT, &root->mac_addr, sizeof(struct mesh_device_mac_type));
+  struct mesh_device_iter_type iter;
+  struct mesh_device_node_type node;
+
+  mesh_device_iter_open(&iter);
+  while (mesh_device_iter_next(&iter, &node)) {
+    hash += mesh_device_flash_hash(MESH_DEVICE_FLASH_HASH_INIT, &node.mac_addr, sizeof(struct mesh_device_mac_type));
+  }
+  mesh_device_iter_close(&iter);
+  return hash;
+}
+
+/*------------------------------------*/
+
+// Restore the list of registered nodes from the current snapshot in flash;
+// nodes are registered with the age they had, when the root-device was last
+// confirmed before the snapshot was written (cf. mesh_device_flash_save), so
+// that nodes, which have left the mesh-network in the meantime, expire as
+// usual
+bool ICACHE_FLASH_ATTR mesh_device_flash_load(void) {
+  uint16_t base = mesh_device_flash_base();
+
+  if (!base) {
+    os_printf("mesh_device_flash_load: Unknown flash-map!\n");
+    return false;
+  }
+
+  uint32_t buf[MESH_DEVICE_FLASH_CHUNK*sizeof(struct mesh_device_flash_node_type)/sizeof(uint32_t)];
+  struct mesh_device_flash_node_type *nodes = (struct mesh_device_flash_node_type *) buf;
+  struct mesh_device_flash_header_type header;
+  const struct mesh_device_node_type *root = NULL;
+  uint32_t addr = 0;
+  uint16_t idx = 0, chunk = 0, node_idx = 0;
+
+  if (!mesh_device_flash_find(base, &header)) {
+    os_printf("mesh_device_flash_load: No valid snapshot found!\n");
+    return false;
+  }
+
+  mesh_device_list_init();
+  if (!mesh_device_root_set(&header.root)) {
+    os_printf("mesh_device_flash_load: Failed to set the root-device!\n");
+    return false;
+  }
+
+  addr = flash_sector*SPI_FLASH_SEC_SIZE+sizeof(struct mesh_device_flash_header_type);
+  for (idx = 0; idx < header.count; idx += chunk) {
+    chunk = header.count-idx < MESH_DEVICE_FLASH_CHUNK ? header.count-idx : MESH_DEVICE_FLASH_CHUNK;
+    if (spi_flash_read(addr+idx*sizeof(struct mesh_device_flash_node_type), (uint32 *) buf, chunk*sizeof(struct mesh_device_flash_node_type)) != SPI_FLASH_RESULT_OK) {
+      os_printf("mesh_device_flash_load: Reading the snapshot failed!\n");
+      return false;
+    }
+    for (node_idx = 0; node_idx < chunk; node_idx++) {
+      mesh_device_add_aged(&nodes[node_idx].mac_addr, nodes[node_idx].age*1000);
+    }
+  }
+
+  // The restored list doesn't have to be written again
+  if (mesh_device_root_get(&root)) {
+    flash_nodes_hash = mesh_device_flash_nodes_hash(root);
+  }
+  flash_check_time = system_get_time();
+  flash_check_time_valid = true;
+
+  os_printf("mesh_device_flash_load: Restored %d nodes from snapshot %d!\n", mesh_device_list_count(), flash_seq);
+  return true;
+}
+
+// Write a snapshot of the list of registered nodes to flash, if it has changed
+// since the last snapshot and MESH_DEVICE_FLASH_SAVE_INTERVAL has passed (or
+// force is true, e.g. before the list is released). The age of every node is
+// measured against the timestamp of the root-device, i.e. the last
+// reconciliation, which confirmed the list (cf. mesh_device_sync_begin);
+// otherwise a snapshot written long after it (e.g. shortly before the next
+// topology-test) would store ages beyond SUB_NODE_TIMEOUT_THRESHOLD, so that
+// the nodes would be dropped on the next restore.
+bool ICACHE_FLASH_ATTR mesh_device_flash_save(bool force) {
+  uint16_t base = mesh_device_flash_base();
+
+  if (!base) {
+    os_printf("mesh_device_flash_save: Unknown flash-map!\n");
+    return false;
+  }
+
+  const struct mesh_device_node_type *root = NULL;
+  uint32_t timestamp = system_get_time(), nodes_hash = 0;
+
+  if (!mesh_device_root_get(&root)) {  // Nothing to save
+    return false;
+  }
+  if (!force && flash_check_time_valid && (timestamp-flash_check_time)/1000 < MESH_DEVICE_FLASH_SAVE_INTERVAL) {
+    return true;
+  }
+  flash_check_time = timestamp;
+  flash_check_time_valid = true;
+
+  struct mesh_device_flash_header_type header;
+
+  if (!flash_found) { // Continue the sequence of the snapshots already in flash
+    mesh_device_flash_find(base, &header);
+  }
+  nodes_hash = mesh_device_flash_nodes_hash(root);
+  if (flash_sector && nodes_hash == flash_nodes_hash) { // Unchanged
+    return true;
+  }
+
+  uint32_t buf[MESH_DEVICE_FLASH_CHUNK*sizeof(struct mesh_device_flash_node_type)/sizeof(uint32_t)];
+  struct mesh_device_flash_node_type *nodes = (struct mesh_device_flash_node_type *) buf;
+  struct mesh_device_iter_type iter;
+  struct mesh_device_node_type node;
+  uint16_t sector = flash_sector == base ? base+1 : base; // Overwrite the older snapshot
+  uint32_t addr = sector*SPI_FLASH_SEC_SIZE+sizeof(struct mesh_device_flash_header_type), age = 0;
+  uint16_t chunk = 0;
+  bool success = true;
+
+  os_memset(&header, 0, sizeof(struct mesh_device_flash_header_type));
+  header.magic = MESH_DEVICE_FLASH_MAGIC;
+  header.seq = flash_seq+1;
+  os_memcpy(&header.root, &root->mac_addr, sizeof(struct mesh_device_mac_type));
+
+  if (spi_flash_erase_sector(sector) != SPI_FLASH_RESULT_OK) {
+    os_printf("mesh_device_flash_save: Erasing sector %d failed!\n", sector);
+    return false;
+  }
+
+  // Write the nodes chunk by chunk behind the header
+  header.checksum = MESH_DEVICE_FLASH_HASH_INIT;
+  mesh_device_iter_open(&iter);
+  while (success && header.count < MESH_DEVICE_FLASH_NODES_MAX && mesh_device_iter_next(&iter, &node)) {
+    os_memcpy(&nodes[chunk].mac_addr, &node.mac_addr, sizeof(struct mesh_device_mac_type));
+    age = (int32_t) (root->timestamp-node.timestamp) > 0 ? (root->timestamp-node.timestamp)/1000000 : 0;
+    nodes[chunk].age = age < 0xFFFF ? age : 0xFFFF;
+    header.count++;
+    if (++chunk == MESH_DEVICE_FLASH_CHUNK) {
+      success = spi_flash_write(addr, (uint32 *) buf, chunk*sizeof(struct mesh_device_flash_node_type)) == SPI_FLASH_RESULT_OK;
+      header.checksum = mesh_device_flash_hash(header.checksum, buf, chunk*sizeof(struct mesh_device_flash_node_type));
+      addr += chunk*sizeof(struct mesh_device_flash_node_type);
+      chunk = 0;
+    }
+  }
+  mesh_device_iter_close(&iter);
+  if (success && chunk > 0) {
+    success = spi_flash_write(addr, (uint32 *) buf, chunk*sizeof(struct mesh_device_flash_node_type)) == SPI_FLASH_RESULT_OK;
+    header.checksum = mesh_device_flash_hash(header.checksum, buf, chunk*sizeof(struct mesh_device_flash_node_type));
+  }
+  if (!success) {
+    os_printf("mesh_device_flash_save: Writing the nodes failed!\n");
+    return false;
+  }
+
+  // Finish the checksum and write the header last; until then, the sector
+  // doesn't contain a valid snapshot
+  header.checksum = mesh_device_flash_hash(header.checksum, &header.seq, sizeof(header.seq));
+  header.checksum = mesh_device_flash_hash(header.checksum, &header.count, sizeof(header.count)+sizeof(header.root));
+  if (spi_flash_write(sector*SPI_FLASH_SEC_SIZE, (uint32 *) &header, sizeof(struct mesh_device_flash_header_type)) != SPI_FLASH_RESULT_OK) {
+    os_printf("mesh_device_flash_save: Writing the header failed!\n");
+    return false;
+  }
+
+  flash_sector = sector;
+  flash_seq = header.seq;
+  flash_nodes_hash = nodes_hash;
+  return true;
+}
@@ -17,80 +17,937 @@
 #include "mem.h"
 #include "osapi.h"
 #include "mesh.h"
+#include "mesh_codec.h"
 #include "mesh_device.h"
+#include "mesh_device_flash.h"
+#include "mesh_pool.h"
+#include "mesh_task.h"
+#include "mesh_tx.h"
 #include "esp_mesh.h"
 #include "mesh_none.h"
 #include "user_config.h"
 
 static os_timer_t *topology_timer = NULL;
 
+// Definition of functions (so there won't be any complications because the
+// compiler resolves the scope top-down):
+static void mesh_topology_request_handle(const struct mesh_parser_view_type *view, uint32_t version, bool versioned);
+static void mesh_topology_relay_flush(void);
+static bool mesh_topology_unchanged_send(struct mesh_device_mac_type *dst, struct mesh_device_mac_type *root, uint16_t seq, uint8_t level);
+
+// Broadcast-address (the MAC-addresses are used for the communication between
+// mesh-nodes instead of an IP-address)
+static struct mesh_device_mac_type topology_broadcast = {{0, 0, 0, 0, 0, 0}};
+
+// Check, whether the given destination-address is a single node (and not the
+// broadcast-address)
+#define mesh_topology_unicast(dst) (os_memcmp((dst), &topology_broadcast, sizeof(struct mesh_device_mac_type)) != 0)
+
+// Maximum number of nodes per packet of a topology-snapshot (one option of the
+// packet is reserved for the snapshot's user-option)
+#define MESH_NONE_SNAPSHOT_NODES_MAX ((ESP_MESH_OP_MAX_PER_PKT-1)*MESH_NONE_USR_OPTION_NODES_MAX)
+
+// Value of topology_snapshot_part, while no snapshot is received
+#define MESH_NONE_SNAPSHOT_PART_NONE 0xFF
+
+// Incremental topology-maintenance: the root-node collects the nodes joining and
+// leaving its device-list and broadcasts them once per topology-test-interval
+// as user-options together with a sequence-number (the SDK's own route-table-
+// updates aren't passed on to the application and don't carry one; their
+// option-types M_O_ROUTE_ADD/-DEL are left to the SDK). The other nodes apply
+// these deltas to their device-list and only fall back to a full topology-
+// request, if they detect a gap in the sequence, a new root, a new parent or
+// if they haven't received a delta for TOPOLOGY_DELTA_TIMEOUT of the root's
+// intervals. Thus, a stable mesh only causes a single broadcast per interval
+// instead of one topology-request and -response per node.
+//
+// The topology-requests themselves aren't answered individually either (which
+// would send one near-identical topology-response per requester down the
+// tree): they are plain broadcasts with a user-option instead of
+// M_O_TOPO_REQ (which the SDK would answer by itself), the root collects them
+// for TOPOLOGY_SNAPSHOT_WINDOW and then broadcasts a single snapshot of its
+// device-list (again as user-options), which carries the sequence-number of the
+// next delta and is applied by every node, that isn't up to date yet. Moreover,
+// only requests announcing a new parent are broadcasted; all others are sent to
+// the parent-node, which answers them from its own device-list, as long as it
+// is up to date itself, so that they don't have to travel up to the root (whose
+// link is the bottleneck of the mesh). Besides, every request carries the
+// version of the requester's device-list (cf. mesh_device_list_version): if it
+// matches the one of the answering node, only a short reply (MESH_NONE_USR_
+// OPTION_UNCHANGED) is sent instead of the snapshot, which saves nearly all of
+// the bytes on stable meshes.
+//
+// Furthermore, the interval between two topology-tests adapts to the observed
+// churn: as long as no node joins or leaves, it is doubled after every
+// topology-test up to TOPOLOGY_TIME_INTERVAL_MAX; any change (as well as a
+// newly joined sub-node or a failed rebuild of the mesh, cf.
+// mesh_topology_trigger) drops it back to TOPOLOGY_TIME_INTERVAL. The root
+// announces its current interval with every delta, so that the other nodes
+// scale their timeout accordingly.
+//
+// A snapshot of a large device-list is split into several parts, which are
+// numbered, so that they are applied in order: parts arriving ahead of a
+// missing one are buffered (at most TOPOLOGY_SNAPSHOT_BUFFERS) and applied,
+// once it has arrived. A snapshot, which misses more parts or isn't complete
+// within TOPOLOGY_SNAPSHOT_TIMEOUT, is discarded without expiring any nodes.
+static uint16_t topology_seq = 0;         // Root: sequence-number of the next delta; other nodes: sequence-number of the last applied one
+static bool topology_seq_valid = false;   // A delta has been applied since the last full topology-request
+static bool topology_synced = false;      // The device-list matches the root's one (no delta has been missed since the last full topology-request)
+static uint32_t topology_quiet = 0;       // Time since the last delta from the root (in ms)
+static uint8_t topology_root_level = 0;   // Backoff-level of the root's topology-tests (cf. topology_level), announced with its last delta
+static bool topology_parent_valid = false;
+static struct mesh_device_mac_type topology_parent;  // Parent-node announced with the last topology-request
+
+static os_timer_t *topology_snapshot_timer = NULL;  // Root: collects topology-requests for TOPOLOGY_SNAPSHOT_WINDOW before the snapshot is broadcasted
+static bool topology_snapshot_pending = false;      // Root: a snapshot is scheduled
+static uint16_t topology_snapshot_seq = 0;          // Sequence-number of the snapshot, that is currently received
+static uint8_t topology_snapshot_part = MESH_NONE_SNAPSHOT_PART_NONE;  // Next expected part of that snapshot
+static uint32_t topology_snapshot_time = 0;         // System-time, when that snapshot has been started
+static struct mesh_none_snapshot_part_type topology_snapshot_buffers[TOPOLOGY_SNAPSHOT_BUFFERS]; // Parts of that snapshot, which arrived ahead of the next expected one
+
+static bool topology_parent_announced = false; // The current parent-node has been broadcasted with a topology-request
+
+static struct mesh_header_format *topology_request = NULL;  // Cached topology-request (cf. mesh_topology_request_get)
+static struct mesh_device_mac_type topology_request_src;    // Source-address of the cached topology-request
+static struct mesh_device_mac_type topology_request_dst;    // Destination-address of the cached topology-request
+static uint8_t *topology_request_version = NULL;            // Version of the device-list in the cached topology-request (cf. mesh_topology_request_get)
+
+static struct mesh_device_mac_type topology_relay_pending[MESH_DEVICE_FAN_OUT]; // Child-nodes, whose topology-request is answered once the device is up to date again
+static uint32_t topology_relay_pending_version[MESH_DEVICE_FAN_OUT];              // Version of their device-lists (cf. mesh_device_list_version)
+static bool topology_relay_pending_versioned[MESH_DEVICE_FAN_OUT];                // Their topology-request carried a version
+static uint8_t topology_relay_pending_count = 0;
+
+static struct mesh_device_mac_type topology_delta_add[TOPOLOGY_DELTA_MAX];  // Nodes, that joined the root's device-list since the last delta
+static struct mesh_device_mac_type topology_delta_del[TOPOLOGY_DELTA_MAX];  // Nodes, that left the root's device-list since the last delta
+static uint8_t topology_delta_add_count = 0, topology_delta_del_count = 0;
+static bool topology_delta_overflow = false;  // More nodes changed, than fit into the delta
+
+static uint8_t topology_level = 0;        // Backoff-level of the topology-tests: interval = TOPOLOGY_TIME_INTERVAL << topology_level
+static uint16_t topology_changes = 0;     // Number of nodes, that joined or left the device-list since the last topology-test
+static struct mesh_topology_stats_type topology_stats;  // Statistics of the topology-tests for monitoring
+
+// Return the interval between two topology-tests for the given backoff-level
+// (in ms)
+#define mesh_topology_interval(level) ((uint32_t) TOPOLOGY_TIME_INTERVAL << (level))
+
+// Limit the given backoff-level (announced by another node) to the one of
+// TOPOLOGY_TIME_INTERVAL_MAX
+static uint8_t ICACHE_FLASH_ATTR mesh_topology_level_limit(uint8_t level) {
+  uint8_t limit = 0;
+
+  while (limit < level && mesh_topology_interval(limit+1) <= TOPOLOGY_TIME_INTERVAL_MAX) {
+    limit++;
+  }
+  return limit;
+}
+
+// Drop to the fast topology-test-interval (e.g. after a node joined or the mesh
+// failed to be rebuilt), so that changes of the topology are picked up quickly;
+// the timer isn't re-armed, if the fast interval is already in use (so that a
+// burst of events doesn't postpone the next topology-test)
+void ICACHE_FLASH_ATTR mesh_topology_trigger(void) {
+  if (!topology_timer || topology_level == 0) {
+    return;
+  }
+
+  topology_level = 0;
+  topology_stats.interval = mesh_topology_interval(topology_level);
+  os_timer_disarm(topology_timer);
+  os_timer_arm(topology_timer, topology_stats.interval, false);
+}
+
+// Return the statistics of the topology-tests (current interval, change-rate,
+// etc.) for monitoring
+void ICACHE_FLASH_ATTR mesh_topology_stats_get(struct mesh_topology_stats_type *stats) {
+  if (!stats) {
+    os_printf("mesh_topology_stats_get: Invalid transfer parameter!\n");
+    return;
+  }
+
+  os_memcpy(stats, &topology_stats, sizeof(struct mesh_topology_stats_type));
+}
+
+// Apply a delta broadcasted by the root-node (cf. mesh_topology_delta_send) with
+// the given sequence-number and backoff-level to the device-list; if a delta
+// has been missed or the root has changed, a full topology-request is issued
+// with the next topology-test instead
+static void ICACHE_FLASH_ATTR mesh_topology_delta_apply(const struct mesh_parser_view_type *view, uint16_t seq, uint8_t level) {
+  uint16_t changes = topology_changes;
+  uint8_t pos = MESH_PARSER_OPTION_NONE;
+  struct mesh_header_option_format *option = NULL;
+  const struct mesh_device_node_type *root = NULL;
+
+  if (espconn_mesh_is_root() || !topology_synced) { // The root is the origin of the deltas; unsynchronized nodes are updated by the pending topology-response
+    return;
+  }
+  if (!mesh_device_root_get(&root) || os_memcmp(root->mac_addr.mac, view->header->src_addr, sizeof(struct mesh_device_mac_type))) {
+    topology_synced = false;
+    mesh_topology_trigger();
+    return;
+  }
+  if (topology_seq_valid && seq == topology_seq) {  // Duplicate
+    return;
+  }
+  if (topology_seq_valid && seq != (uint16_t) (topology_seq+1)) {
+    os_printf("mesh_topology_delta_apply: Missed %d topology-deltas! Resynchronizing!\n", (uint16_t) (seq-topology_seq-1));
+    topology_synced = false;
+    mesh_topology_trigger();
+    return;
+  }
+  topology_seq = seq;
+  topology_seq_valid = true;
+  topology_quiet = 0;
+  topology_root_level = mesh_topology_level_limit(level);
+
+  while ((option = mesh_parser_option_next(view, M_O_USR_OPTION, &pos))) {
+    if (option->olen > 1 && option->ovalue[0] == MESH_NONE_USR_OPTION_ADD) {
+      if (!mesh_device_add((struct mesh_device_mac_type *) &option->ovalue[1], (option->olen-1)/sizeof(struct mesh_device_mac_type))) {
+        os_printf("mesh_topology_delta_apply: Failed to add new sub-nodes!\n");
+      }
+    }
+    else if (option->olen > 1 && option->ovalue[0] == MESH_NONE_USR_OPTION_DEL) {
+      mesh_device_del((struct mesh_device_mac_type *) &option->ovalue[1], (option->olen-1)/sizeof(struct mesh_device_mac_type));
+    }
+  }
+
+  // The delta confirms all other registered nodes, so that they don't expire
+  // (or get dropped when the list is restored from flash)
+  mesh_device_refresh();
+  if (topology_changes != changes) {  // The topology is changing; check it more often again
+    mesh_topology_trigger();
+  }
+
+  // Persist the list of registered nodes, if it has changed (rate-limited)
+  mesh_device_flash_save(false);
+}
+
+// Pass the MAC-addresses of the node-options (MESH_NONE_USR_OPTION_NODES) of the
+// given snapshot-part on to the running reconciliation of the device-list (cf.
+// mesh_device_sync_begin)
+static void ICACHE_FLASH_ATTR mesh_topology_resp_sync(const struct mesh_parser_view_type *view) {
+  uint8_t pos = MESH_PARSER_OPTION_NONE;
+  struct mesh_header_option_format *option = NULL;
+
+  while ((option = mesh_parser_option_next(view, M_O_USR_OPTION, &pos))) {
+    if (option->olen < 1 || option->ovalue[0] != MESH_NONE_USR_OPTION_NODES) {
+      continue;
+    }
+    if (!mesh_device_sync_nodes((struct mesh_device_mac_type *) &option->ovalue[1], (option->olen-1)/sizeof(struct mesh_device_mac_type))) {
+      os_printf("mesh_topology_resp_sync: Failed to add new sub-nodes!\n");
+    }
+  }
+}
+
+// Discard the snapshot, that is currently received, and free its buffered parts
+static void ICACHE_FLASH_ATTR mesh_topology_snapshot_discard(void) {
+  uint8_t idx = 0;
+
+  for (idx = 0; idx < TOPOLOGY_SNAPSHOT_BUFFERS; idx++) {
+    if (topology_snapshot_buffers[idx].nodes) {
+      mesh_pool_release(topology_snapshot_buffers[idx].nodes);
+      topology_snapshot_buffers[idx].nodes = NULL;
+    }
+  }
+  topology_snapshot_part = MESH_NONE_SNAPSHOT_PART_NONE;
+}
+
+// Discard the snapshot, that is currently received, if it hasn't been completed
+// within TOPOLOGY_SNAPSHOT_TIMEOUT
+static void ICACHE_FLASH_ATTR mesh_topology_snapshot_expire(void) {
+  if (topology_snapshot_part != MESH_NONE_SNAPSHOT_PART_NONE && (system_get_time()-topology_snapshot_time)/1000 >= TOPOLOGY_SNAPSHOT_TIMEOUT) {
+    os_printf("mesh_topology_snapshot_expire: Snapshot %d is incomplete! Discarding it!\n", topology_snapshot_seq);
+    mesh_topology_snapshot_discard();
+  }
+}
+
+// Copy the MAC-addresses of the node-options of the given snapshot-part, which
+// arrived ahead of the next expected one, into a free buffer; return false, if
+// all buffers are in use
+static bool ICACHE_FLASH_ATTR mesh_topology_snapshot_buffer(const struct mesh_parser_view_type *view, uint8_t part) {
+  uint8_t pos = MESH_PARSER_OPTION_NONE, idx = 0;
+  uint16_t count = 0;
+  struct mesh_header_option_format *option = NULL;
+  struct mesh_none_snapshot_part_type *buffer = NULL;
+
+  for (idx = 0; idx < TOPOLOGY_SNAPSHOT_BUFFERS; idx++) {
+    if (topology_snapshot_buffers[idx].nodes && topology_snapshot_buffers[idx].part == part) { // Duplicate
+      return true;
+    }
+    if (!topology_snapshot_buffers[idx].nodes && !buffer) {
+      buffer = &topology_snapshot_buffers[idx];
+    }
+  }
+  if (!buffer) {
+    return false;
+  }
+
+  while ((option = mesh_parser_option_next(view, M_O_USR_OPTION, &pos))) {
+    if (option->olen >= 1 && option->ovalue[0] == MESH_NONE_USR_OPTION_NODES) {
+      count += (option->olen-1)/sizeof(struct mesh_device_mac_type);
+    }
+  }
+  buffer->nodes = (struct mesh_device_mac_type *) mesh_pool_acquire(count > 0 ? count*sizeof(struct mesh_device_mac_type) : 1);
+  if (!buffer->nodes) {
+    return false;
+  }
+  buffer->part = part;
+  buffer->count = 0;
+  pos = MESH_PARSER_OPTION_NONE;
+  while ((option = mesh_parser_option_next(view, M_O_USR_OPTION, &pos))) {
+    if (option->olen >= 1 && option->ovalue[0] == MESH_NONE_USR_OPTION_NODES) {
+      os_memcpy(&buffer->nodes[buffer->count], &option->ovalue[1], (option->olen-1)/sizeof(struct mesh_device_mac_type)*sizeof(struct mesh_device_mac_type));
+      buffer->count += (option->olen-1)/sizeof(struct mesh_device_mac_type);
+    }
+  }
+  return true;
+}
+
+// Pass the buffered snapshot-part with the given index on to the running
+// reconciliation and free its buffer; return false, if it isn't buffered
+static bool ICACHE_FLASH_ATTR mesh_topology_snapshot_drain(uint8_t part) {
+  uint8_t idx = 0;
+
+  for (idx = 0; idx < TOPOLOGY_SNAPSHOT_BUFFERS; idx++) {
+    if (topology_snapshot_buffers[idx].nodes && topology_snapshot_buffers[idx].part == part) {
+      if (!mesh_device_sync_nodes(topology_snapshot_buffers[idx].nodes, topology_snapshot_buffers[idx].count)) {
+        os_printf("mesh_topology_snapshot_drain: Failed to add new sub-nodes!\n");
+      }
+      mesh_pool_release(topology_snapshot_buffers[idx].nodes);
+      topology_snapshot_buffers[idx].nodes = NULL;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Complete the reconciliation with the root's current device-list; from now on,
+// the device-list is kept up to date by the root's deltas
+static void ICACHE_FLASH_ATTR mesh_topology_resp_end(void) {
+  struct mesh_device_sync_type sync_result;
+
+  // Delete all nodes whose timestamp exceeds the defined timeout-threshold
+  // from the list
+  mesh_device_sync_end(&sync_result);
+
+  topology_synced = true;
+  topology_quiet = 0;
+
+  // Display all currently registered nodes
+  mesh_device_list_disp();
+
+  // Persist the list of registered nodes, if it has changed (rate-limited)
+  mesh_device_flash_save(false);
+}
+
+// Apply a part of a snapshot of the root-node's device-list (cf.
+// mesh_topology_snapshot_send) to the own one; the value of its user-option
+// holds the sequence-number of the root's next delta, its backoff-level, the
+// index and the total number of parts as well as the root-device. Nodes, that
+// are already up to date, skip it. The parts are applied in order; parts
+// arriving ahead of a missing one are buffered, until it arrives (cf.
+// mesh_topology_snapshot_buffer).
+static void ICACHE_FLASH_ATTR mesh_topology_snapshot_apply(const struct mesh_parser_view_type *view, uint8_t *value) {
+  uint16_t seq = (value[0] << 8) | value[1];
+  uint8_t level = value[2], part = value[3], parts = value[4];
+  struct mesh_device_mac_type *root = (struct mesh_device_mac_type *) &value[5];
+
+  if (espconn_mesh_is_root()) {
+    return;
+  }
+
+  mesh_topology_snapshot_expire();
+
+  // Any part of another snapshot starts receiving it (the first part of the
+  // current one restarts it, e.g. if the root has sent it again)
+  if (topology_snapshot_part == MESH_NONE_SNAPSHOT_PART_NONE || seq != topology_snapshot_seq || (part == 0 && topology_snapshot_part > 0)) {
+    mesh_topology_snapshot_discard();
+    if (topology_synced && topology_seq_valid && seq == (uint16_t) (topology_seq+1)) { // No delta has been missed
+      mesh_device_refresh();
+      topology_quiet = 0;
+      return;
+    }
+    if (!mesh_device_sync_begin(root)) {
+      os_printf("mesh_topology_snapshot_apply: Failed to set the root-device!\n");
+      return;
+    }
+    topology_snapshot_seq = seq;
+    topology_snapshot_part = 0;
+    topology_snapshot_time = system_get_time();
+  }
+  if (part < topology_snapshot_part || part >= parts) {  // Duplicate (or invalid)
+    return;
+  }
+  if (part > topology_snapshot_part) {  // Arrived ahead of a missing part
+    if (!mesh_topology_snapshot_buffer(view, part)) {
+      os_printf("mesh_topology_snapshot_apply: Too many parts of snapshot %d are missing! Discarding it!\n", seq);
+      mesh_topology_snapshot_discard();
+    }
+    return;
+  }
+
+  // Apply the part and the buffered ones following it
+  mesh_topology_resp_sync(view);
+  topology_snapshot_part++;
+  while (topology_snapshot_part < parts && mesh_topology_snapshot_drain(topology_snapshot_part)) {
+    topology_snapshot_part++;
+  }
+  if (topology_snapshot_part < parts) {
+    return;
+  }
+  mesh_topology_snapshot_discard();
+  mesh_topology_resp_end();
+
+  // The next delta is the one following the snapshot
+  topology_seq = seq-1;
+  topology_seq_valid = true;
+  topology_root_level = mesh_topology_level_limit(level);
+
+  // Answer the postponed topology-requests of the child-nodes
+  mesh_topology_relay_flush();
+}
+
+// Process the short reply to a topology-request, whose version matched the one
+// of the answering node (cf. mesh_topology_unchanged_send): the value of its
+// user-option holds the sequence-number of the root's next delta, its backoff-
+// level, the version of the answering node's device-list and the root-device.
+// It is only applied, if the own device-list still matches; otherwise the
+// next topology-test issues a new request.
+static void ICACHE_FLASH_ATTR mesh_topology_unchanged_apply(uint8_t *value) {
+  uint16_t seq = (value[0] << 8) | value[1];
+  uint8_t level = value[2];
+  uint32_t version = ((uint32_t) value[3] << 24) | ((uint32_t) value[4] << 16) | ((uint32_t) value[5] << 8) | value[6];
+  struct mesh_device_mac_type *root = (struct mesh_device_mac_type *) &value[7];
+  const struct mesh_device_node_type *list_root = NULL;
+
+  if (espconn_mesh_is_root() || topology_synced) {
+    return;
+  }
+  if (!mesh_device_root_get(&list_root) || os_memcmp(list_root->mac_addr.mac, root, sizeof(struct mesh_device_mac_type)) || version != mesh_device_list_version()) {
+    return;
+  }
+
+  // The reply confirms the registered nodes
+  mesh_device_refresh();
+  topology_synced = true;
+  topology_quiet = 0;
+
+  // The next delta is the one following the reply
+  topology_seq = seq-1;
+  topology_seq_valid = true;
+  topology_root_level = mesh_topology_level_limit(level);
+
+  // Answer the postponed topology-requests of the child-nodes
+  mesh_topology_relay_flush();
+}
+
 // Handler-function to process the connected devices' responses to the topology-
 // test; all registered nodes whose timestamp exceeds the defined timeout-
 // threshold and who didn't respond to the topology-test are deleted from the
 // device-list, all registered and responding nodes' timestamp is updated and
-// all not yet registered nodes are newly added
-void ICACHE_FLASH_ATTR mesh_parser_protocol_none(const void *mesh_header, uint8_t *data, uint16_t len) {
-  if (!mesh_header || !data || len <= 0) {
+// all not yet registered nodes are newly added. Furthermore, the parent-option
+// of other nodes' topology-requests as well as the root-node's topology-deltas
+// and -snapshots are processed and the root-node collects the topology-requests
+// for its next snapshot.
+void ICACHE_FLASH_ATTR mesh_parser_protocol_none(const struct mesh_parser_view_type *view, void *ctx) {
+  if (!view || !view->header) {
     os_printf("mesh_parser_protocol_none: Invalid transfer parameters!\n");
     return;
   }
 
-  uint16_t op_idx = 1, dev_count = 0, dev_idx = 0;
-  uint8_t *dev_mac = NULL;
+  uint8_t pos = MESH_PARSER_OPTION_NONE;
   struct mesh_header_option_format *option = NULL;
-  static const struct mesh_device_node_type *node_list_list_cpy;
-  struct mesh_header_format *header = (struct mesh_header_format *) data; // Interprete data as a packet in the mesh-header-format
 
-  // Check, if the message received happens to be a response to the topology-
-  // request
-  if (espconn_mesh_get_option(header, M_O_TOPO_RESP, op_idx, &option)) {
-    // Set the root-device to the received message's source-address (since only
-    // the current root answers a topology-request)
-    if (mesh_device_root_set((struct mesh_device_mac_type *) header->src_addr)) {
-      mesh_device_update_timestamp((struct mesh_device_mac_type *) header->src_addr, 1);
+  // Process the user-options: topology-requests of other nodes carry their
+  // parent-node (insert the sender into the routing-tree accordingly) and are
+  // collected by the root-node for the next snapshot; topology-deltas and
+  // -snapshots of the root-node carry their sequence-number
+  while ((option = mesh_parser_option_next(view, M_O_USR_OPTION, &pos))) {
+    if (option->olen == 1+sizeof(struct mesh_device_mac_type) && option->ovalue[0] == MESH_NONE_USR_OPTION_PARENT) {
+      mesh_device_link((struct mesh_device_mac_type *) view->header->src_addr, (struct mesh_device_mac_type *) &option->ovalue[1]);
+    }
+    else if (option->olen == 1 && option->ovalue[0] == MESH_NONE_USR_OPTION_REQUEST) {  // Request without a version
+      mesh_topology_request_handle(view, 0, false);
+    }
+    else if (option->olen == 5 && option->ovalue[0] == MESH_NONE_USR_OPTION_REQUEST) {
+      mesh_topology_request_handle(view, ((uint32_t) option->ovalue[1] << 24) | ((uint32_t) option->ovalue[2] << 16) | ((uint32_t) option->ovalue[3] << 8) | option->ovalue[4], true);
+    }
+    else if (option->olen == 8+sizeof(struct mesh_device_mac_type) && option->ovalue[0] == MESH_NONE_USR_OPTION_UNCHANGED) {
+      mesh_topology_unchanged_apply(&option->ovalue[1]);
+    }
+    else if (option->olen == 4 && option->ovalue[0] == MESH_NONE_USR_OPTION_SEQ) {
+      mesh_topology_delta_apply(view, (option->ovalue[1] << 8) | option->ovalue[2], option->ovalue[3]);
+    }
+    else if (option->olen == 6+sizeof(struct mesh_device_mac_type) && option->ovalue[0] == MESH_NONE_USR_OPTION_SNAPSHOT) {
+      mesh_topology_snapshot_apply(view, &option->ovalue[1]);
+    }
+  }
+}
+
+// Count a node joining or leaving the device-list (cf. mesh_device_change_
+// handler_set) and, if the device is the root-node, record it for the next
+// delta; a node, that joins and leaves again (or vice versa) between two
+// deltas, cancels out
+static void ICACHE_FLASH_ATTR mesh_topology_change_record(const struct mesh_device_mac_type *node, bool added) {
+  struct mesh_device_mac_type *list = added ? topology_delta_add : topology_delta_del;
+  struct mesh_device_mac_type *opposite = added ? topology_delta_del : topology_delta_add;
+  uint8_t *count = added ? &topology_delta_add_count : &topology_delta_del_count;
+  uint8_t *opposite_count = added ? &topology_delta_del_count : &topology_delta_add_count;
+  uint8_t idx = 0;
+
+  topology_changes++;
+  topology_stats.change_count++;
+  if (!espconn_mesh_is_root()) {
+    return;
+  }
+
+  for (idx = 0; idx < *opposite_count; idx++) {
+    if (!os_memcmp(&opposite[idx], node, sizeof(struct mesh_device_mac_type))) {
+      os_memcpy(&opposite[idx], &opposite[--(*opposite_count)], sizeof(struct mesh_device_mac_type));
+      return;
+    }
+  }
+  if (*count < TOPOLOGY_DELTA_MAX) {
+    os_memcpy(&list[(*count)++], node, sizeof(struct mesh_device_mac_type));
+  }
+  else {
+    topology_delta_overflow = true;
+  }
+}
+
+// Determine the device's own MAC-address depending on its WiFi-operation-mode
+static bool ICACHE_FLASH_ATTR mesh_topology_src_get(struct mesh_device_mac_type *src) {
+  uint8_t op_mode = wifi_get_opmode();
+
+  if (op_mode == SOFTAP_MODE || op_mode == STATION_MODE || op_mode == STATIONAP_MODE) { // Prevent errors resulting from runtime-conditions concerning the WiFi-operation-mode (e.g. if the device is switched into sleep-mode)
+    if (op_mode == SOFTAP_MODE) {
+      wifi_get_macaddr(SOFTAP_IF, src->mac);
     }
     else {
-      os_printf("mesh_parser_protocol_none: Failed to set the root-device!\n");
+      wifi_get_macaddr(STATION_IF, src->mac);
+    }
+    return true;
+  }
+  os_printf("mesh_topology_src_get: Wrong WiFi-operation-mode!\n");
+  return false;
+}
+
+// Create a packet for topology-information from the given source- to the given
+// destination-address (broadcast, if it is the all-zero-address), which can
+// hold options of the given total length (cf. mesh_topology_option_add); the
+// packet is built by mesh_codec.h instead of espconn_mesh_create_packet. Only
+// topology-requests flow upwards; all answers and deltas flow downwards.
+static struct mesh_header_format * ICACHE_FLASH_ATTR mesh_topology_packet_create(struct mesh_device_mac_type *dst, struct mesh_device_mac_type *src, uint16_t ot_len, bool upwards) {
+  uint8_t *buf = (uint8_t *) mesh_pool_acquire(ESP_MESH_HLEN+ot_len);
+
+  if (buf && !mesh_codec_packet_init(buf, ESP_MESH_HLEN+ot_len,
+                                     dst->mac,      // Destination address
+                                     src->mac,      // Source address
+                                     mesh_topology_unicast(dst), // P2P flag
+                                     false,         // Flow request flag (not set, because topology-packets are small and a set flag signals congestion to the receiving sub-nodes, cf. mesh_tx_congest_handle)
+                                     upwards,       // Direction flag
+                                     M_PROTO_NONE,  // Communication-protocol
+                                     true)) {       // Option flag
+    mesh_pool_release(buf);
+    buf = NULL;
+  }
+  return (struct mesh_header_format *) buf;
+}
+
+// Add an option with the given type and value to the given packet, which has
+// been created for options of the given total length (cf. mesh_topology_
+// packet_create)
+static bool ICACHE_FLASH_ATTR mesh_topology_option_add(struct mesh_header_format *header, uint16_t ot_len, uint8_t otype, uint8_t *ovalue, uint8_t olen) {
+  return mesh_codec_option_append(header, ESP_MESH_HLEN+ot_len, otype, ovalue, olen);
+}
+
+// Determine the device's parent-node; the SDK returns the parent's softAP-MAC-
+// address, which differs from its station-MAC-address (used to address the
+// node in the mesh) only in the locally-administered-bit
+static bool ICACHE_FLASH_ATTR mesh_topology_parent_get(struct mesh_device_mac_type *parent) {
+  uint16_t parent_count = 0;
+  struct mesh_device_mac_type *parent_info = NULL;
+  bool result = false;
+
+  if (espconn_mesh_get_node_info(MESH_NODE_PARENT, (uint8_t **) &parent_info, &parent_count)) {
+    if (parent_info && parent_count >= 1) {
+      os_memcpy(parent, parent_info, sizeof(struct mesh_device_mac_type));
+      parent->mac[0] &= ~0x02;
+      result = true;
+    }
+    espconn_mesh_get_node_info(MESH_NODE_PARENT, NULL, NULL);
+  }
+  return result;
+}
+
+// Free the cached topology-request (e.g. if the parent-node has changed)
+static void ICACHE_FLASH_ATTR mesh_topology_request_free(void) {
+  if (topology_request) {
+    mesh_pool_release(topology_request);
+    topology_request = NULL;
+    topology_request_version = NULL;
+  }
+}
+
+// Return the topology-request from the given source- to the given destination-
+// address; the packet is only built once and reused by every topology-test,
+// until the device's MAC-address (e.g. due to a change of the WiFi-operation-
+// mode), the destination or its parent-node changes (only the version of the
+// device-list is updated in place). Instead of M_O_TOPO_REQ (which the SDK of
+// the root-node answers individually), the packet carries a user-option, which
+// is answered by a snapshot or, if the version matches, by a short reply (cf.
+// mesh_topology_request_handle), as well as the parent-node (if it is known),
+// so that the receiving nodes can insert the device into their routing-tree.
+static struct mesh_header_format * ICACHE_FLASH_ATTR mesh_topology_request_get(struct mesh_device_mac_type *dst, struct mesh_device_mac_type *src) {
+  uint8_t parent_option[1+sizeof(struct mesh_device_mac_type)];
+  uint8_t request_option[5] = {MESH_NONE_USR_OPTION_REQUEST};
+  uint16_t ot_len = sizeof(struct mesh_header_option_header_type) + sizeof(struct mesh_header_option_format) + sizeof(request_option);
+  uint32_t version = mesh_device_list_version();
+  struct mesh_header_option_format *option = NULL;
+
+  if (!topology_request || os_memcmp(&topology_request_src, src, sizeof(struct mesh_device_mac_type)) || os_memcmp(&topology_request_dst, dst, sizeof(struct mesh_device_mac_type))) {
+    mesh_topology_request_free();
+
+    if (topology_parent_valid) {
+      parent_option[0] = MESH_NONE_USR_OPTION_PARENT;
+      os_memcpy(&parent_option[1], &topology_parent, sizeof(struct mesh_device_mac_type));
+      ot_len += sizeof(struct mesh_header_option_format) + sizeof(parent_option);
+    }
+
+    // Initialize the topology-request
+    topology_request = mesh_topology_packet_create(dst, src, ot_len, true);
+    if (!topology_request) {
+      os_printf("mesh_topology_request_get: Creating the topology-request-package failed!\n");
+      return NULL;
     }
 
-    // Extract the MAC-addresses of the current mesh-nodes from the messages
-    // options-field (the corresponding key is M_O_TOPO_RESP) add not yet
-    // registered nodes to the device-list and update the device's timestamps
-    while (espconn_mesh_get_option(header, M_O_TOPO_RESP, op_idx++, &option)) {
-      dev_count = option->olen/sizeof(struct mesh_device_mac_type);
-      dev_mac = option->ovalue;
-      if (mesh_device_add((struct mesh_device_mac_type *) dev_mac, dev_count)) {  // Redundant (already registered) nodes are caught in mesh_device_add(...), so no reason to worry about this here
-        mesh_device_update_timestamp((struct mesh_device_mac_type *) dev_mac, dev_count);
+    // Add the request-option as well as the parent-option to the package
+    if (!mesh_topology_option_add(topology_request, ot_len, M_O_USR_OPTION, request_option, sizeof(request_option))
+        || (topology_parent_valid && !mesh_topology_option_add(topology_request, ot_len, M_O_USR_OPTION, parent_option, sizeof(parent_option)))
+        || !(option = mesh_codec_option_find(topology_request, M_O_USR_OPTION, 1))) {
+      os_printf("mesh_topology_request_get: Failed to add the topology-request-option to the package!\n");
+      mesh_topology_request_free();
+      return NULL;
+    }
+    topology_request_version = &option->ovalue[1];
+    os_memcpy(&topology_request_src, src, sizeof(struct mesh_device_mac_type));
+    os_memcpy(&topology_request_dst, dst, sizeof(struct mesh_device_mac_type));
+  }
+
+  // Update the version of the device-list (big-endian)
+  topology_request_version[0] = version >> 24;
+  topology_request_version[1] = (version >> 16) & 0xFF;
+  topology_request_version[2] = (version >> 8) & 0xFF;
+  topology_request_version[3] = version & 0xFF;
+  return topology_request;
+}
+
+// Broadcast the nodes, that joined or left the root-node's device-list since
+// the last delta, together with the delta's sequence-number and the current
+// backoff-level; the delta is sent every topology-test-interval, even if it is
+// empty, so that the other nodes notice a missed one. If more nodes changed
+// than fit into a delta, a sequence-number is skipped instead, which causes
+// the other nodes to resynchronize.
+static bool ICACHE_FLASH_ATTR mesh_topology_delta_send(void) {
+  struct mesh_device_mac_type src;
+  struct mesh_header_format *header = NULL;
+  uint8_t seq_option[4], add_option[1+TOPOLOGY_DELTA_MAX*sizeof(struct mesh_device_mac_type)], del_option[1+TOPOLOGY_DELTA_MAX*sizeof(struct mesh_device_mac_type)];
+  uint16_t ot_len = sizeof(struct mesh_header_option_header_type) + sizeof(struct mesh_header_option_format) + sizeof(seq_option);
+  bool result = false;
+
+  if (!mesh_topology_src_get(&src)) {
+    return false;
+  }
+
+  if (topology_delta_overflow) {
+    topology_seq++;
+    topology_delta_add_count = 0;
+    topology_delta_del_count = 0;
+    topology_delta_overflow = false;
+  }
+  seq_option[0] = MESH_NONE_USR_OPTION_SEQ;
+  seq_option[1] = topology_seq >> 8;
+  seq_option[2] = topology_seq & 0xFF;
+  seq_option[3] = topology_level;
+  add_option[0] = MESH_NONE_USR_OPTION_ADD;
+  os_memcpy(&add_option[1], topology_delta_add, topology_delta_add_count*sizeof(struct mesh_device_mac_type));
+  del_option[0] = MESH_NONE_USR_OPTION_DEL;
+  os_memcpy(&del_option[1], topology_delta_del, topology_delta_del_count*sizeof(struct mesh_device_mac_type));
+  if (topology_delta_add_count > 0) {
+    ot_len += sizeof(struct mesh_header_option_format) + 1 + topology_delta_add_count*sizeof(struct mesh_device_mac_type);
+  }
+  if (topology_delta_del_count > 0) {
+    ot_len += sizeof(struct mesh_header_option_format) + 1 + topology_delta_del_count*sizeof(struct mesh_device_mac_type);
+  }
+
+  header = mesh_topology_packet_create(&topology_broadcast, &src, ot_len, false);
+  if (header) {
+    if (mesh_topology_option_add(header, ot_len, M_O_USR_OPTION, seq_option, sizeof(seq_option))
+        && (topology_delta_add_count == 0 || mesh_topology_option_add(header, ot_len, M_O_USR_OPTION, add_option, 1+topology_delta_add_count*sizeof(struct mesh_device_mac_type)))
+        && (topology_delta_del_count == 0 || mesh_topology_option_add(header, ot_len, M_O_USR_OPTION, del_option, 1+topology_delta_del_count*sizeof(struct mesh_device_mac_type)))) {
+      if (mesh_tx_send(esp_mesh_conn, (uint8_t *) header, header->len)) {
+        // The delta has been sent; start collecting the next one
+        topology_seq++;
+        topology_delta_add_count = 0;
+        topology_delta_del_count = 0;
+        result = true;
       }
       else {
-        os_printf("mesh_parser_protocol_none: Failed to add new sub-nodes!\n");
+        os_printf("mesh_topology_delta_send: Error while sending the topology-delta!\n");
       }
     }
+    else {
+      os_printf("mesh_topology_delta_send: Failed to add the options to the package!\n");
+    }
+    mesh_pool_release(header);
+  }
+  else {
+    os_printf("mesh_topology_delta_send: Creating the topology-delta-package failed!\n");
+  }
+  return result;
+}
 
-    // Get the all currently registered nodes
-    mesh_device_list_get(&node_list_list_cpy, &dev_idx);
+// Send a snapshot of the device-list to the given destination-address (the
+// root-node broadcasts it, a relay-node answers a single child-node); it is
+// applied by all receiving nodes, that aren't up to date, and carries the root-
+// device, the sequence-number of the root's next delta and its backoff-level
+// (so that the nodes can continue with the deltas afterwards). The snapshot is
+// split into several packets, if the device-list doesn't fit into one.
+static bool ICACHE_FLASH_ATTR mesh_topology_snapshot_send(struct mesh_device_mac_type *dst, struct mesh_device_mac_type *root, uint16_t seq, uint8_t level) {
+  struct mesh_device_mac_type src;
+  uint8_t nodes_option[1+MESH_NONE_USR_OPTION_NODES_MAX*sizeof(struct mesh_device_mac_type)];
+  struct mesh_device_iter_type iter;
+  struct mesh_device_node_type node;
+  struct mesh_header_format *header = NULL;
+  uint8_t snapshot_option[6+sizeof(struct mesh_device_mac_type)];
+  uint16_t count = mesh_device_list_count(), part_count = 0, nodes_count = 0, ot_len = 0;
+  uint8_t part = 0, parts = count > 0 ? (count+MESH_NONE_SNAPSHOT_NODES_MAX-1)/MESH_NONE_SNAPSHOT_NODES_MAX : 1;
+  bool result = true;
 
-    // Delete all nodes whose timestamp exceeds the defined timeout-threshold
-    // from the list
-    if (node_list_list_cpy) {
-      while (dev_idx-- > 0) {
-        if ((system_get_time()-node_list_list_cpy[dev_idx].timestamp)/1000 > SUB_NODE_TIMEOUT_THRESHOLD) {  // Has to be divided by 1000 because timestamp and the systemtime are given in microseconds and not in milliseconds
-          mesh_device_del((struct mesh_device_mac_type *) &node_list_list_cpy[dev_idx].mac_addr, 1);
-        }
+  if (!mesh_topology_src_get(&src) || !mesh_device_iter_open(&iter)) {
+    return false;
+  }
+
+  snapshot_option[0] = MESH_NONE_USR_OPTION_SNAPSHOT;
+  snapshot_option[1] = seq >> 8;
+  snapshot_option[2] = seq & 0xFF;
+  snapshot_option[3] = level;
+  snapshot_option[5] = parts;
+  os_memcpy(&snapshot_option[6], root, sizeof(struct mesh_device_mac_type));
+  nodes_option[0] = MESH_NONE_USR_OPTION_NODES;
+  for (part = 0; part < parts && result; part++) {
+    part_count = count-part*MESH_NONE_SNAPSHOT_NODES_MAX < MESH_NONE_SNAPSHOT_NODES_MAX ? count-part*MESH_NONE_SNAPSHOT_NODES_MAX : MESH_NONE_SNAPSHOT_NODES_MAX;
+    ot_len = sizeof(struct mesh_header_option_header_type) + sizeof(struct mesh_header_option_format) + sizeof(snapshot_option)
+             + (part_count+MESH_NONE_USR_OPTION_NODES_MAX-1)/MESH_NONE_USR_OPTION_NODES_MAX*(sizeof(struct mesh_header_option_format)+1) + part_count*sizeof(struct mesh_device_mac_type);
+    snapshot_option[4] = part;
+
+    header = mesh_topology_packet_create(dst, &src, ot_len, false);
+    if (!header) {
+      os_printf("mesh_topology_snapshot_send: Creating the topology-snapshot-package failed!\n");
+      result = false;
+      break;
+    }
+    result = mesh_topology_option_add(header, ot_len, M_O_USR_OPTION, snapshot_option, sizeof(snapshot_option));
+
+    // Add the nodes of this part in node-options of the maximum option-length
+    while (result && part_count > 0) {
+      nodes_count = 0;
+      while (nodes_count < MESH_NONE_USR_OPTION_NODES_MAX && part_count > 0 && mesh_device_iter_next(&iter, &node)) {
+        os_memcpy(&nodes_option[1+nodes_count*sizeof(struct mesh_device_mac_type)], &node.mac_addr, sizeof(struct mesh_device_mac_type));
+        nodes_count++;
+        part_count--;
       }
+      result = nodes_count > 0 && mesh_topology_option_add(header, ot_len, M_O_USR_OPTION, nodes_option, 1+nodes_count*sizeof(struct mesh_device_mac_type));
+    }
+
+    if (!result) {
+      os_printf("mesh_topology_snapshot_send: Failed to add the options to the package!\n");
+    }
+    else if (!mesh_tx_send(esp_mesh_conn, (uint8_t *) header, header->len)) {
+      os_printf("mesh_topology_snapshot_send: Error while sending the topology-snapshot!\n");
+      result = false;
+    }
+    mesh_pool_release(header);
+  }
+
+  mesh_device_iter_close(&iter);
+  return result;
+}
+
+// Send the short reply to a topology-request, whose version matches the one of
+// the own device-list, to the given destination-address; like a snapshot, it
+// carries the root-device, the sequence-number of the root's next delta and its
+// backoff-level, but only the version instead of the nodes (cf. mesh_topology_
+// unchanged_apply)
+static bool ICACHE_FLASH_ATTR mesh_topology_unchanged_send(struct mesh_device_mac_type *dst, struct mesh_device_mac_type *root, uint16_t seq, uint8_t level) {
+  struct mesh_device_mac_type src;
+  struct mesh_header_format *header = NULL;
+  uint8_t unchanged_option[8+sizeof(struct mesh_device_mac_type)];
+  uint16_t ot_len = sizeof(struct mesh_header_option_header_type) + sizeof(struct mesh_header_option_format) + sizeof(unchanged_option);
+  uint32_t version = mesh_device_list_version();
+  bool result = false;
+
+  if (!mesh_topology_src_get(&src)) {
+    return false;
+  }
+
+  unchanged_option[0] = MESH_NONE_USR_OPTION_UNCHANGED;
+  unchanged_option[1] = seq >> 8;
+  unchanged_option[2] = seq & 0xFF;
+  unchanged_option[3] = level;
+  unchanged_option[4] = version >> 24;
+  unchanged_option[5] = (version >> 16) & 0xFF;
+  unchanged_option[6] = (version >> 8) & 0xFF;
+  unchanged_option[7] = version & 0xFF;
+  os_memcpy(&unchanged_option[8], root, sizeof(struct mesh_device_mac_type));
+
+  header = mesh_topology_packet_create(dst, &src, ot_len, false);
+  if (header) {
+    if (mesh_topology_option_add(header, ot_len, M_O_USR_OPTION, unchanged_option, sizeof(unchanged_option))) {
+      if (mesh_tx_send(esp_mesh_conn, (uint8_t *) header, header->len)) {
+        topology_stats.unchanged_count++;
+        result = true;
+      }
+      else {
+        os_printf("mesh_topology_unchanged_send: Error while sending the reply!\n");
+      }
+    }
+    else {
+      os_printf("mesh_topology_unchanged_send: Failed to add the option to the package!\n");
+    }
+    mesh_pool_release(header);
+  }
+  else {
+    os_printf("mesh_topology_unchanged_send: Creating the reply-package failed!\n");
+  }
+  return result;
+}
+
+// Broadcast the snapshot, once the topology-requests have been collected for
+// TOPOLOGY_SNAPSHOT_WINDOW (executed by the task of mesh_task.c)
+static void ICACHE_FLASH_ATTR mesh_topology_snapshot_run(void *arg, uint8_t *data, uint16_t len) {
+  struct mesh_device_mac_type src;
+
+  topology_snapshot_pending = false;
+  if (!topology_snapshot_timer) { // The topology-tests have been disabled in the meantime
+    return;
+  }
+  if (espconn_mesh_is_root() && mesh_topology_src_get(&src) && mesh_topology_snapshot_send(&topology_broadcast, &src, topology_seq, topology_level)) {
+    topology_stats.snapshot_count++;
+  }
+}
+
+// Timer-function of the topology-snapshots: the snapshot is sent by the task of
+// mesh_task.c (or directly, if it can't be queued)
+static void ICACHE_FLASH_ATTR mesh_topology_snapshot_timerfunc(void *arg) {
+  if (!mesh_task_post(mesh_topology_snapshot_run, NULL, NULL, 0)) {
+    mesh_topology_snapshot_run(NULL, NULL, 0);
+  }
+}
+
+// Schedule a snapshot in reply to a topology-request, if the device is the root-
+// node; all further requests within TOPOLOGY_SNAPSHOT_WINDOW are answered by
+// the same snapshot
+static void ICACHE_FLASH_ATTR mesh_topology_snapshot_schedule(void) {
+  if (!topology_snapshot_timer || topology_snapshot_pending || !espconn_mesh_is_root()) {
+    return;
+  }
+
+  topology_snapshot_pending = true;
+  os_timer_disarm(topology_snapshot_timer);
+  os_timer_setfn(topology_snapshot_timer, (os_timer_func_t *) mesh_topology_snapshot_timerfunc, NULL);
+  os_timer_arm(topology_snapshot_timer, TOPOLOGY_SNAPSHOT_WINDOW, false);
+}
+
+// Answer the topology-request of the given child-node from the own device-list,
+// which serves as cache of the root's one: it is considered fresh, as long as
+// the root's next delta isn't overdue. If the child's device-list matches the
+// own one (i.e. the given version is the own one), the short reply is sent
+// instead of a snapshot.
+static bool ICACHE_FLASH_ATTR mesh_topology_relay(struct mesh_device_mac_type *child, uint32_t version, bool versioned) {
+  const struct mesh_device_node_type *root = NULL;
+
+  if (!topology_synced || !topology_seq_valid || topology_quiet > mesh_topology_interval(topology_root_level) || !mesh_device_root_get(&root)) {
+    return false;
+  }
+  if (versioned && version == mesh_device_list_version()) {
+    if (!mesh_topology_unchanged_send(child, (struct mesh_device_mac_type *) &root->mac_addr, topology_seq+1, topology_root_level)) {
+      return false;
     }
+  }
+  else if (!mesh_topology_snapshot_send(child, (struct mesh_device_mac_type *) &root->mac_addr, topology_seq+1, topology_root_level)) {
+    return false;
+  }
+  topology_stats.relay_count++;
+  return true;
+}
+
+// Answer the topology-requests of the child-nodes, which have been postponed,
+// since the device itself wasn't up to date
+static void ICACHE_FLASH_ATTR mesh_topology_relay_flush(void) {
+  uint8_t idx = 0;
 
-    // Display all currently registered nodes
-    mesh_device_list_disp();
+  while (topology_relay_pending_count > 0) {
+    idx = topology_relay_pending_count-1;
+    if (!mesh_topology_relay(&topology_relay_pending[idx], topology_relay_pending_version[idx], topology_relay_pending_versioned[idx])) {
+      break;
+    }
+    topology_relay_pending_count--;
   }
 }
 
+// Process a topology-request with the given version of the requester's device-
+// list (if versioned): the root-node answers it with the short reply, if the
+// version matches the one of its own device-list, and otherwise with its next
+// snapshot (cf. mesh_topology_snapshot_schedule); a relay-node answers the
+// requests of its child-nodes (which are sent to it directly) from its own
+// device-list, if it is up to date, and otherwise postpones them, until it has
+// been resynchronized itself. Broadcasted requests (announcing a new parent)
+// are left to the root.
+static void ICACHE_FLASH_ATTR mesh_topology_request_handle(const struct mesh_parser_view_type *view, uint32_t version, bool versioned) {
+  struct mesh_device_mac_type src;
+  struct mesh_device_mac_type *child = (struct mesh_device_mac_type *) view->header->src_addr;
+  uint8_t idx = 0;
+
+  if (espconn_mesh_is_root()) {
+    if (!versioned || version != mesh_device_list_version() || !mesh_topology_src_get(&src) || !mesh_topology_unchanged_send(child, &src, topology_seq, topology_level)) {
+      mesh_topology_snapshot_schedule();
+    }
+    return;
+  }
+  if (!mesh_topology_src_get(&src) || os_memcmp(view->header->dst_addr, &src, sizeof(struct mesh_device_mac_type))) {
+    return;
+  }
+
+  if (mesh_topology_relay(child, version, versioned)) {
+    return;
+  }
+
+  // Postpone the answer and resynchronize with the next topology-test
+  for (idx = 0; idx < topology_relay_pending_count; idx++) {
+    if (!os_memcmp(&topology_relay_pending[idx], child, sizeof(struct mesh_device_mac_type))) {
+      break;
+    }
+  }
+  if (idx == topology_relay_pending_count && topology_relay_pending_count < MESH_DEVICE_FAN_OUT) {
+    os_memcpy(&topology_relay_pending[topology_relay_pending_count++], child, sizeof(struct mesh_device_mac_type));
+  }
+  if (idx < topology_relay_pending_count) {
+    topology_relay_pending_version[idx] = version;
+    topology_relay_pending_versioned[idx] = versioned;
+  }
+  topology_synced = false;
+  mesh_topology_trigger();
+}
+
 // This function initiates a test of the mesh-network's topology. The concrete
 // process of this topology-test is differs based on the device's role in the
-// network. Whilst a root-node can directly call up it's sub-nodes, a non-root-
-// device has to broadcast a topology-request to all connected devices,
-// which is then answered by the root-node (broadcast because the sub-node
-// doesn't know it's current root-device).
+// network. Whilst a root-node can directly call up it's sub-nodes (and
+// propagates the changes to the other nodes as delta), a non-root-device has
+// to broadcast a topology-request to all connected devices, which is then
+// answered by the root-node (broadcast because the sub-node doesn't know it's
+// current root-device). The topology-request is only necessary, if the
+// device-list can't be kept up to date by the root's deltas (cf.
+// mesh_topology_delta_apply).
 static bool ICACHE_FLASH_ATTR mesh_topology_test(void) {
   if (!esp_mesh_conn) {
     os_printf("mesh_topology_test: Please initialzie esp_mesh_conn before trying to execute a topology-test!\n");
@@ -101,57 +958,57 @@ static bool ICACHE_FLASH_ATTR mesh_topology_test(void) {
     return false;
   }
 
-  uint8_t op_mode = 0;
-  struct mesh_device_mac_type src, dst;
+  bool parent_known = false;
+  struct mesh_device_mac_type src, parent;
   struct mesh_header_format *header = NULL;
-  struct mesh_header_option_format *option = NULL;
-  uint8_t ot_len = sizeof(struct mesh_header_option_header_type) + sizeof(struct mesh_header_option_format) + sizeof(struct mesh_device_mac_type);
+
+  // The registered nodes are confirmed once per topology-test-interval of the
+  // root-device (by its own topology-test or by its delta), so they are only
+  // deleted after they have been missing for several of these intervals
+  mesh_device_timeout_set(TOPOLOGY_TIMEOUT_TESTS*mesh_topology_interval(espconn_mesh_is_root() ? topology_level : topology_root_level));
 
   // If the device is the mesh-network's root-node, it can directly call up it's
   // sub-nodes, so a topology-request via a broadcast isn't necessary.
   if (espconn_mesh_is_root()) {
-    uint16_t sub_dev_count = 0, dev_idx = 0;
+    uint16_t idx = 0, sub_dev_count = 0, child_count = 0;
     struct mesh_device_mac_type *sub_dev_mac = NULL;
-    static const struct mesh_device_node_type *node_list_list_cpy;
+    struct mesh_sub_node_info *child_info = NULL;
+    struct mesh_device_sync_type sync_result;
+
+    topology_synced = false;  // Resynchronize, once the device isn't the root anymore
 
     // Obtain the root-device's sub-node's MAC-addresses
     if (espconn_mesh_get_node_info(MESH_NODE_ALL, (uint8_t **) &sub_dev_mac, &sub_dev_count)) {
       if (sub_dev_count >= 1) {
-        // The first entry is the router's (= "the root-node's root") MAC-address
-        if (mesh_device_root_set(sub_dev_mac)) {
-          mesh_device_update_timestamp(sub_dev_mac, 1);
-        }
-        else {
-          os_printf("mesh_topology_test: Failed to set the root-device!\n");
-        }
-        if (sub_dev_count > 1) {
-          // Add the sub-nodes to the list of registered devices and update their
-          // timestamp
-          if (mesh_device_add(sub_dev_mac+1, sub_dev_count-1)) {
-            mesh_device_update_timestamp(sub_dev_mac+1, sub_dev_count-1);
-          }
-          else {
-            os_printf("mesh_topology_test: Failed to add new sub-nodes!\n");
-          }
+        // The first entry is the router's (= "the root-node's root") MAC-address;
+        // reconcile the list of registered devices with the sub-nodes in a
+        // single pass (add new nodes, update the timestamp of the registered
+        // ones and delete all nodes whose timestamp exceeds the defined timeout-
+        // threshold)
+        if (!mesh_device_sync(sub_dev_mac, sub_dev_mac+1, sub_dev_count-1, &sync_result)) {
+          os_printf("mesh_topology_test: Failed to reconcile the list of registered devices!\n");
         }
-      }
-
-      // Get the all currently registered nodes
-      mesh_device_list_get(&node_list_list_cpy, &dev_idx);
 
-      // Delete all nodes whose timestamp exceeds the defined timeout-threshold
-      // from the list
-      if (node_list_list_cpy) {
-        while (dev_idx-- > 0) {
-          if ((system_get_time()-node_list_list_cpy[dev_idx].timestamp)/1000 > SUB_NODE_TIMEOUT_THRESHOLD) {  // Has to be divided by 1000 because timestamp and the systemtime are given in microseconds and not in milliseconds
-            mesh_device_del((struct mesh_device_mac_type *) &node_list_list_cpy[dev_idx].mac_addr, 1);
+        // The root-device's direct sub-nodes form the first layer of the
+        // routing-tree; the deeper layers are learned from the parent-option
+        // of the sub-nodes' topology-requests
+        if (espconn_mesh_get_node_info(MESH_NODE_CHILD, (uint8_t **) &child_info, &child_count)) {
+          for (idx = 0; idx < child_count; idx++) {
+            mesh_device_link((struct mesh_device_mac_type *) child_info[idx].mac, sub_dev_mac);
           }
+          espconn_mesh_get_node_info(MESH_NODE_CHILD, NULL, NULL);
         }
       }
 
+      // Propagate the changes of the device-list to the other nodes
+      mesh_topology_delta_send();
+
       // Display all currently registered nodes
       mesh_device_list_disp();
 
+      // Persist the list of registered nodes, if it has changed (rate-limited)
+      mesh_device_flash_save(false);
+
       // Release the memory occupied by the MAC-addresses
       espconn_mesh_get_node_info(MESH_NODE_ALL, NULL, NULL);
 
@@ -167,76 +1024,91 @@ static bool ICACHE_FLASH_ATTR mesh_topology_test(void) {
       return false;
     }
 
-    // Check for the operation-mode of the device and get the respective MAC-address
-    op_mode = wifi_get_opmode();
-    if (op_mode == SOFTAP_MODE || op_mode == STATION_MODE || op_mode == STATIONAP_MODE) { // Prevent errors resulting from runtime-conditions concerning the WiFi-operation-mode (e.g. if the device is switched into sleep-mode)
-      if (op_mode == SOFTAP_MODE) {
-        wifi_get_macaddr(SOFTAP_IF, src.mac);
-      }
-      else {
-        wifi_get_macaddr(STATION_IF, src.mac);
-      }
-    }
-    else {
-      os_printf("mesh_topology_test: Wrong WiFi-operation-mode!\n");
+    // Get the device's MAC-address depending on its operation-mode
+    if (!mesh_topology_src_get(&src)) {
       return false;
     }
 
-    // Since the root-node isn't known yet, one has to broadcast the topology-
-    // request to all connected devices
-    os_memset(&dst, 0, sizeof(struct mesh_device_mac_type));  // Set broadcast-address as destination (the MAC-addresses are used for the communication between mesh-nodes instead of an IP-address)
+    // Insert the device into the own routing-tree below its parent
+    parent_known = mesh_topology_parent_get(&parent);
+    if (parent_known) {
+      mesh_device_link(&src, &parent);
+    }
 
-    // Initialize the topology-request
-    header = (struct mesh_header_format *) espconn_mesh_create_packet(dst.mac,      // Destination address
-                                                                      src.mac,      // Source address
-                                                                      false,        // P2P flag
-                                                                      true,         // Flow request flag (if set to true, the request for a permit to send data to avoid network congestion (cf. Isarithmetic Congestion Control) will be piggybacked onto the message)
-                                                                      M_PROTO_NONE, // Communication-protocol
-                                                                      0,            // Data length
-                                                                      true,         // Option flag
-                                                                      ot_len,       // Total option length
-                                                                      false,        // Fragmentation flag (allow fragmentation)
-                                                                      0,            // Fragmentation type (options for the fragment)
-                                                                      false,        // More fragmentation flag (indicates, if this fragment is the last of a package or if more fragments are following)
-                                                                      0,            // Fragmentation index/offset (postion of the fragment's data in relation to the first byte of the package)
-                                                                      0);           // Fragmentation id (identity of the frame; espacially important in a mesh-network since the different fragments might take different paths to reach the target)
+    // A new parent has to be announced to the other nodes by a topology-request;
+    // otherwise, skip it as long as the device-list is kept up to date by the
+    // root's deltas
+    if (parent_known != topology_parent_valid || (parent_known && os_memcmp(&topology_parent, &parent, sizeof(struct mesh_device_mac_type)))) {
+      topology_parent_valid = parent_known;
+      topology_parent_announced = false;
+      if (parent_known) {
+        os_memcpy(&topology_parent, &parent, sizeof(struct mesh_device_mac_type));
+      }
+      mesh_topology_request_free(); // The cached topology-request carries the old parent
+    }
+    else if (topology_parent_announced && topology_synced && topology_quiet < TOPOLOGY_DELTA_TIMEOUT*mesh_topology_interval(topology_root_level)) {
+      topology_quiet += mesh_topology_interval(topology_level);
+      return true;
+    }
+    topology_synced = false;
+    topology_stats.request_count++;
+    topology_quiet = 0;
 
+    // Try to send the (cached) topology-request: a new parent is announced to
+    // all other mesh-nodes by a broadcast, otherwise the request is sent to the
+    // parent only, which answers it from its own device-list (cf.
+    // mesh_topology_request_handle), so that it doesn't have to travel up to
+    // the root
+    header = mesh_topology_request_get(topology_parent_valid && topology_parent_announced ? &topology_parent : &topology_broadcast, &src);
     if (header) {
-      // Create the topology-request-option
-      option = (struct mesh_header_option_format *) espconn_mesh_create_option(M_O_TOPO_REQ, dst.mac, sizeof(struct mesh_device_mac_type));
-      if (option) {
-        // Add the topology-request-option to the package
-        if (espconn_mesh_add_option(header, option)) {
-          // Try to broadcast the package to all other mesh-nodes
-          if (!espconn_mesh_sent(esp_mesh_conn, (uint8_t *) header, header->len)) {
-            // Free occupied resouces
-            os_free(header);
-            os_free(option);
-            return true;
-          }
-          else {
-            os_printf("mesh_topology_test: Error while sending the topology-request-package!\n");
-          }
-        }
-        else {
-          os_printf("mesh_topology_test: Failed to add the topology-request-option to the package!\n");
-        }
+      if (mesh_tx_send(esp_mesh_conn, (uint8_t *) header, header->len)) {
+        topology_parent_announced = topology_parent_valid;
+        return true;
       }
       else {
-        os_printf("mesh_topology_test: Creation of the topology-request-option failed!\n");
+        os_printf("mesh_topology_test: Error while sending the topology-request-package!\n");
       }
     }
-    else {
-      os_printf("mesh_topology_test: Creating the topology-request-package failed!\n");
-    }
-    // Free occupied resouces
-    if (header) {
-      os_free(header);
-    }
-    if (option) {
-      os_free(option);
-    }
-    return false;
+  }
+  return false;
+}
+
+// Execute a topology-test and re-arm the timer with the next interval, which
+// is doubled (up to TOPOLOGY_TIME_INTERVAL_MAX) as long as no node joins or
+// leaves (neither during the topology-test nor by deltas received since the
+// last one) and dropped back to TOPOLOGY_TIME_INTERVAL otherwise (executed by
+// the task of mesh_task.c)
+static void ICACHE_FLASH_ATTR mesh_topology_test_run(void *arg, uint8_t *data, uint16_t len) {
+  uint32_t interval = mesh_topology_interval(topology_level);
+
+  if (!topology_timer) {  // The topology-tests have been disabled in the meantime
+    return;
+  }
+
+  // Free the buffers of a snapshot, which hasn't been completed in time
+  mesh_topology_snapshot_expire();
+
+  mesh_topology_test();
+
+  // Smoothed change-rate (joining and leaving nodes per hour)
+  topology_stats.change_rate = (3*topology_stats.change_rate + topology_changes*(3600000/interval))/4;
+
+  if (topology_changes > 0) {
+    topology_level = 0;
+  }
+  else if (mesh_topology_interval(topology_level+1) <= TOPOLOGY_TIME_INTERVAL_MAX) {
+    topology_level++;
+  }
+  topology_changes = 0;
+  topology_stats.interval = mesh_topology_interval(topology_level);
+  os_timer_arm(topology_timer, topology_stats.interval, false);
+}
+
+// Timer-function of the topology-tests: the topology-test is executed by the
+// task of mesh_task.c (or directly, if it can't be queued)
+static void ICACHE_FLASH_ATTR mesh_topology_timerfunc(void *arg) {
+  if (!mesh_task_post(mesh_topology_test_run, NULL, NULL, 0)) {
+    mesh_topology_test_run(NULL, NULL, 0);
   }
 }
 
@@ -250,6 +1122,25 @@ void ICACHE_FLASH_ATTR mesh_topology_disable(void) {
     topology_timer = NULL;
   }
 
+  if (topology_snapshot_timer) {
+    os_timer_disarm(topology_snapshot_timer);
+    os_free(topology_snapshot_timer);
+    topology_snapshot_timer = NULL;
+  }
+  topology_snapshot_pending = false;
+  mesh_topology_snapshot_discard();
+
+  mesh_device_change_handler_set(NULL); // Stop recording topology-deltas
+  mesh_topology_request_free();
+  topology_synced = false;
+  topology_parent_valid = false;
+  topology_parent_announced = false;
+  topology_relay_pending_count = 0;
+  topology_delta_add_count = 0;
+  topology_delta_del_count = 0;
+  topology_delta_overflow = false;
+
+  mesh_device_flash_save(true); // Persist the current state of the device-list, so that it can be restored after a restart
   mesh_device_list_release(); // Release the device-list to free the occupied resources
 }
 
@@ -260,6 +1151,8 @@ void ICACHE_FLASH_ATTR mesh_topology_init(void) {
     return;
   }
 
+  struct mesh_device_mac_type src;
+
   os_printf("mesh_com_init: Initializing periodical topology-tests!\n");
 
   // Initialize the timer
@@ -270,12 +1163,38 @@ void ICACHE_FLASH_ATTR mesh_topology_init(void) {
     os_printf("mesh_topology_init: Failed to initialize the timer for the periodical topology-tests!\n");
     return;
   }
+  if (!topology_snapshot_timer) {
+    topology_snapshot_timer = (os_timer_t *) os_zalloc(sizeof(os_timer_t));
+  }
+  if (!topology_snapshot_timer) {
+    os_printf("mesh_topology_init: Failed to initialize the timer for the topology-snapshots!\n");
+    return;
+  }
 
-  // Initialize the device-list
+  // Initialize the device-list and restore it from the last snapshot in flash
+  // (if there is one), so that the other nodes can be addressed right away
   mesh_device_list_init();
+  mesh_device_flash_load();
+
+  // Record the changes of the device-list, so that they can be propagated as
+  // topology-delta, if the device is the root-node
+  mesh_device_change_handler_set(mesh_topology_change_record);
+
+  // Build the topology-request in advance, so that the topology-tests only have
+  // to send it
+  if (!espconn_mesh_is_root() && mesh_topology_src_get(&src)) {
+    topology_parent_valid = mesh_topology_parent_get(&topology_parent);
+    mesh_topology_request_get(&topology_broadcast, &src);
+  }
+
+  // Start with the fast interval, since the topology isn't known yet
+  topology_level = 0;
+  os_memset(&topology_stats, 0, sizeof(struct mesh_topology_stats_type));
+  topology_stats.interval = mesh_topology_interval(topology_level);
 
-  // Initialize the timer and assign the function to test the mesh's topology
+  // Initialize the timer and assign the function to test the mesh's topology;
+  // the timer is re-armed with the next interval after every topology-test
   os_timer_disarm(topology_timer);
-  os_timer_setfn(topology_timer, (os_timer_func_t *) mesh_topology_test, NULL);
-  os_timer_arm(topology_timer, TOPOLOGY_TIME_INTERVAL, true);
+  os_timer_setfn(topology_timer, (os_timer_func_t *) mesh_topology_timerfunc, NULL);
+  os_timer_arm(topology_timer, topology_stats.interval, false);
 }
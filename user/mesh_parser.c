@@ -5,7 +5,7 @@
 // 2017-05-02
 //
 // Description: This class provides a parser for messages between mesh-nodes,
-// determining the communication-protocol used from a list of known protocols
+// determining the communication-protocol used from a table of known protocols
 // and passing it on to the respective handler-class. It serves as a facade
 // towards extern classes to hide the underlying complexity of the parsing-
 // procedure (cf. facade-pattern in terms of pattern-based-programming).
@@ -15,66 +15,167 @@
 #include "mem.h"
 #include "osapi.h"
 #include "mesh.h"
+#include "mesh_codec.h"
 #include "mesh_none.h"
 #include "mesh_device.h"
 #include "mesh_parser.h"
+#include "mesh_tx.h"
 
-// List of all supported communication-protocols
-// Structure: {M_PROTO_Protocol, handler-funciton}
-// Can be extended by further communication-protocols in the following manner:
-// static struct mesh_parser_protocol_type supported_protocols[] = {
-//  {M_PROTO_NONE, mesh_parser_protocol_none},
-//  {M_PROTO_MQTT, mesh_parser_protocol_mqtt},
-//  {M_PROTO_BIN, mesh_parser_protocol_bin},
-//  ...
-// };
-static struct mesh_parser_protocol_type supported_protocols[] = {
-  {M_PROTO_NONE, mesh_parser_protocol_none},
+// Dispatch-table of the supported communication-protocols, indexed by the
+// protocol (M_PROTO_...); further protocols are added at runtime by
+// mesh_parser_register, e.g.:
+// mesh_parser_register(M_PROTO_MQTT, mesh_parser_protocol_mqtt, NULL);
+static struct mesh_parser_protocol_type supported_protocols[MESH_PARSER_PROTOCOL_SLOTS] = {
+  [M_PROTO_NONE] = {mesh_parser_protocol_none, NULL, 0},
 };
 
+// Number of dropped packets per reason (cf. enum mesh_parser_drop_type); the
+// drops are only counted (instead of printed), so that malformed or foreign
+// traffic doesn't block the receive-path with output on the UART
+static uint32_t parser_drops[MESH_PARSER_DROP_REASONS];
+
+// Register the given handler-function (and the context passed on to it) for
+// the given communication-protocol, replacing the current one; NULL removes the
+// current one
+bool ICACHE_FLASH_ATTR mesh_parser_register(uint8_t protocol, mesh_parser_protocol_handler handler, void *ctx) {
+  if (protocol >= MESH_PARSER_PROTOCOL_SLOTS) {
+    os_printf("mesh_parser_register: Invalid transfer parameter!\n");
+    return false;
+  }
+
+  supported_protocols[protocol].handler = handler;
+  supported_protocols[protocol].ctx = ctx;
+  supported_protocols[protocol].hits = 0;
+  return true;
+}
+
+// Return the number of packets, that have been passed on to the handler-
+// function of the given communication-protocol
+uint32_t ICACHE_FLASH_ATTR mesh_parser_hits_get(uint8_t protocol) {
+  if (protocol >= MESH_PARSER_PROTOCOL_SLOTS) {
+    os_printf("mesh_parser_hits_get: Invalid transfer parameter!\n");
+    return 0;
+  }
+  return supported_protocols[protocol].hits;
+}
+
+// Return the number of packets, that have been dropped for the given reason
+// (cf. enum mesh_parser_drop_type)
+uint32_t ICACHE_FLASH_ATTR mesh_parser_drops_get(uint8_t reason) {
+  if (reason >= MESH_PARSER_DROP_REASONS) {
+    os_printf("mesh_parser_drops_get: Invalid transfer parameter!\n");
+    return 0;
+  }
+  return parser_drops[reason];
+}
+
+// Return the next option of the given type of the parsed packet-view; pos holds
+// the index of the current option and has to be initialized with
+// MESH_PARSER_OPTION_NONE to start with the first one. NULL is returned, if
+// there are no more options of the type.
+struct mesh_header_option_format * ICACHE_FLASH_ATTR mesh_parser_option_next(const struct mesh_parser_view_type *view, uint8_t otype, uint8_t *pos) {
+  if (!view || !pos || otype >= MESH_PARSER_OPTION_TYPES) {
+    return NULL;
+  }
+
+  *pos = *pos == MESH_PARSER_OPTION_NONE ? view->option_first[otype] : view->option_next[*pos];
+  return *pos == MESH_PARSER_OPTION_NONE ? NULL : view->options[*pos];
+}
+
+// Index the options of the given (checked) packet in a single pass and chain
+// them by their type; return false, if an option exceeds the option-list or
+// the packet contains more than MESH_PARSER_OPTIONS_MAX options
+static bool ICACHE_FLASH_ATTR mesh_parser_options_parse(struct mesh_parser_view_type *view) {
+  uint8_t last[MESH_PARSER_OPTION_TYPES];
+  uint16_t offset = 0;
+  struct mesh_header_option_format *option = NULL;
+
+  os_memset(view->option_first, MESH_PARSER_OPTION_NONE, sizeof(view->option_first));
+  os_memset(last, MESH_PARSER_OPTION_NONE, sizeof(last));
+  view->option_count = 0;
+
+  while ((option = mesh_codec_option_next(view->header, &offset))) {
+    if (view->option_count >= MESH_PARSER_OPTIONS_MAX) {
+      return false;
+    }
+    view->options[view->option_count] = option;
+    view->option_next[view->option_count] = MESH_PARSER_OPTION_NONE;
+    if (option->otype < MESH_PARSER_OPTION_TYPES) { // Unknown options are kept in the list, but aren't chained
+      if (last[option->otype] == MESH_PARSER_OPTION_NONE) {
+        view->option_first[option->otype] = view->option_count;
+      }
+      else {
+        view->option_next[last[option->otype]] = view->option_count;
+      }
+      last[option->otype] = view->option_count;
+    }
+    view->option_count++;
+  }
+  return mesh_codec_options_end(view->header, offset);
+}
+
 // Parser-function, that resolves a  given message, determines the communication-
-// protocol in use and passes the data-part of the packet to the respective
-// handler-funciton
+// protocol in use and passes a parsed view of the packet (cf. struct
+// mesh_parser_view_type) to the respective handler-funciton (looked up
+// directly in the dispatch-table); the packet is decoded by mesh_codec.h
+// instead of the accessors of the SDK.
+//
+// Invalid packets are rejected by a sequence of cheap checks (ordered by their
+// costs) before any option is read and are only counted (cf.
+// mesh_parser_drops_get).
 void ICACHE_FLASH_ATTR mesh_packet_parser(void *arg, uint8_t *data, uint16_t len) {
-  if (!arg || !data || len <= 0) {
-    os_printf("mesh_packet_parser: Invalid transfer parameters!\n");
+  if (!arg) {
+    os_printf("mesh_packet_parser: Invalid transfer parameter!\n");
     return;
   }
 
-  uint16_t idx = 0, usr_data_len = 0;
-  uint8_t *usr_data = NULL;
-  enum mesh_usr_proto_type protocol;
-  struct mesh_header_format *header = (struct mesh_header_format *) data; // Interprete data as a packet in the mesh-header-format
-  uint16_t protocol_count = sizeof(supported_protocols)/sizeof(supported_protocols[0]); // Determine the actual number of supported protocols
-
-  // Try to resolve the communication-protocol in use
-  if (espconn_mesh_get_usr_data_proto(header, &protocol)) {
-    // Get the user-data as well as the respective length
-    if (!espconn_mesh_get_usr_data(header, &usr_data, &usr_data_len)) {
-      // Since the packet doesn't contain a data-part in case of a topology-
-      // request, the header itself is set as the data to parse
-      usr_data = data;
-      usr_data_len = len;
-    }
+  uint8_t protocol = 0;
+  struct mesh_parser_protocol_type *entry = NULL;
+  struct mesh_parser_view_type view;
 
-    // Search the list of supported protocols for the messages protocol
-    for (idx = 0; idx < protocol_count; idx++) {
-      if (supported_protocols[idx].protocol == protocol) {
-        if (supported_protocols[idx].handler == NULL) { // Protocol is included in the list, but the corresponding handler-function is missing
-          os_printf("mesh_packet_parser: No handler-function available!\n");
-          break;
-        }
-        supported_protocols[idx].handler(header, usr_data, usr_data_len); // Pass the data-part of the packet to the respective handler-function
-        break;
-      }
-    }
-    // Check, if the for-loop has been completely cycled through (meaning, that
-    // the protocol in use is not supported)
-    if (idx == protocol_count) {
-      os_printf("mesh_packet_parser: Protocol is not supported!\n");
-    }
+  view.header = (struct mesh_header_format *) data; // Interprete data as a packet in the mesh-header-format
+  view.len = len;
+
+  // Validate the packet (empty packets are handed over without data by
+  // mesh_task.c)
+  if (!data || len < ESP_MESH_HLEN || len > ESP_MESH_PKT_LEN_MAX) {
+    parser_drops[MESH_PARSER_DROP_LENGTH]++;
+    return;
+  }
+  if (view.header->ver != ESP_MESH_VER) {
+    parser_drops[MESH_PARSER_DROP_VERSION]++;
+    return;
   }
-  else {
-    os_printf("mesh_packet_parser: Failed to resolve the protocol!\n");
+  if (!mesh_codec_header_check(view.header, len)) {
+    parser_drops[MESH_PARSER_DROP_HEADER]++;
+    return;
+  }
+
+  // Evaluate the congestion-flags of the packet (independent of its protocol)
+  mesh_tx_congest_handle(view.header);
+
+  // Resolve the communication-protocol in use
+  protocol = mesh_codec_proto_get(view.header);
+  if (protocol >= MESH_PARSER_PROTOCOL_SLOTS || !supported_protocols[protocol].handler) {
+    parser_drops[MESH_PARSER_DROP_PROTOCOL]++;
+    return;
   }
+  entry = &supported_protocols[protocol];
+
+  // Index the options of the packet
+  if (!mesh_parser_options_parse(&view)) {
+    parser_drops[MESH_PARSER_DROP_OPTIONS]++;
+    return;
+  }
+
+  // Get the user-data as well as the respective length
+  if (!mesh_codec_usr_data_get(view.header, &view.usr_data, &view.usr_data_len)) {
+    // Since the packet doesn't contain a data-part in case of a topology-
+    // request, the header itself is set as the data to parse
+    view.usr_data = data;
+    view.usr_data_len = len;
+  }
+
+  entry->hits++;
+  entry->handler(&view, entry->ctx); // Pass the parsed packet to the respective handler-function
 }
@@ -0,0 +1,143 @@
+// mesh_pool.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: This class provides a pool of statically allocated buffers for
+// mesh-packets, so that the send- and receive-paths (cf. mesh_none.c,
+// mesh_task.c and mesh_tx.c) don't have to allocate every packet from the
+// heap. This way, steady traffic doesn't fragment the heap and the time to get
+// a buffer doesn't depend on its state.
+//
+// The pool consists of two slabs: MESH_POOL_SMALL_COUNT buffers of
+// MESH_POOL_SMALL_SIZE for short packets (e.g. topology-requests and -deltas)
+// and MESH_POOL_LARGE_COUNT buffers, which hold a whole packet. A request is
+// served by the smallest free buffer, that is large enough; only if all of
+// them are in use, it falls back to the heap (which is counted, so that the
+// pool can be sized by its statistics). The buffers aren't initialized.
+
+#include "mem.h"
+#include "osapi.h"
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "user_config.h"
+
+// Number of 32-bit-words of a buffer of the given size (the buffers are aligned
+// to 4 byte)
+#define mesh_pool_words(size) (((size)+3)/4)
+
+static uint32_t pool_small[MESH_POOL_SMALL_COUNT][mesh_pool_words(MESH_POOL_SMALL_SIZE)];
+static uint32_t pool_large[MESH_POOL_LARGE_COUNT][mesh_pool_words(MESH_POOL_LARGE_SIZE)];
+static uint8_t pool_small_free[MESH_POOL_SMALL_COUNT];
+static uint8_t pool_large_free[MESH_POOL_LARGE_COUNT];
+static uint8_t pool_small_in_use[(MESH_POOL_SMALL_COUNT+7)/8];
+static uint8_t pool_large_in_use[(MESH_POOL_LARGE_COUNT+7)/8];
+
+static struct mesh_pool_slab_type pool_slabs[MESH_POOL_CLASSES] = {
+  [MESH_POOL_SMALL] = {(uint8_t *) pool_small, pool_small_free, pool_small_in_use, 0, {sizeof(pool_small[0]), MESH_POOL_SMALL_COUNT}},
+  [MESH_POOL_LARGE] = {(uint8_t *) pool_large, pool_large_free, pool_large_in_use, 0, {sizeof(pool_large[0]), MESH_POOL_LARGE_COUNT}},
+};
+
+// Check, whether the buffer with the given index of the given slab is acquired
+#define mesh_pool_in_use(slab, idx) ((slab)->in_use[(idx) >> 3] & (1 << ((idx) & 7)))
+
+static bool pool_initialized = false;
+
+// Mark all buffers as free
+static void ICACHE_FLASH_ATTR mesh_pool_init(void) {
+  uint8_t pool_class = 0, idx = 0;
+  struct mesh_pool_slab_type *slab = NULL;
+
+  for (pool_class = 0; pool_class < MESH_POOL_CLASSES; pool_class++) {
+    slab = &pool_slabs[pool_class];
+    for (idx = 0; idx < slab->stats.count; idx++) {
+      slab->free[idx] = slab->stats.count-1-idx;  // The first buffer is on top of the stack
+    }
+    slab->free_count = slab->stats.count;
+  }
+  pool_initialized = true;
+}
+
+// Acquire a buffer of (at least) the given size; return NULL, if neither the
+// pool nor the heap can provide one
+void * ICACHE_FLASH_ATTR mesh_pool_acquire(uint16_t size) {
+  uint8_t pool_class = 0, fitting = MESH_POOL_CLASSES, idx = 0;
+  struct mesh_pool_slab_type *slab = NULL;
+
+  if (size == 0) {
+    os_printf("mesh_pool_acquire: Invalid transfer parameter!\n");
+    return NULL;
+  }
+  if (!pool_initialized) {
+    mesh_pool_init();
+  }
+
+  for (pool_class = 0; pool_class < MESH_POOL_CLASSES; pool_class++) {
+    slab = &pool_slabs[pool_class];
+    if (size > slab->stats.size) {
+      continue;
+    }
+    if (fitting == MESH_POOL_CLASSES) {
+      fitting = pool_class;
+    }
+    if (slab->free_count > 0) {
+      slab->stats.acquired++;
+      slab->stats.used++;
+      if (slab->stats.used > slab->stats.used_max) {
+        slab->stats.used_max = slab->stats.used;
+      }
+      idx = slab->free[--slab->free_count];
+      slab->in_use[idx >> 3] |= 1 << (idx & 7);
+      return slab->buf + idx*slab->stats.size;
+    }
+  }
+
+  // All suitable buffers are in use (or the size exceeds the large ones)
+  pool_slabs[fitting == MESH_POOL_CLASSES ? MESH_POOL_LARGE : fitting].stats.fallbacks++;
+  return os_malloc(size);
+}
+
+// Release the given buffer (acquired by mesh_pool_acquire)
+void ICACHE_FLASH_ATTR mesh_pool_release(void *buf) {
+  uint8_t pool_class = 0, idx = 0;
+  uint32_t offset = 0;
+  struct mesh_pool_slab_type *slab = NULL;
+
+  if (!buf) {
+    return;
+  }
+
+  for (pool_class = 0; pool_class < MESH_POOL_CLASSES; pool_class++) {
+    slab = &pool_slabs[pool_class];
+    if ((uint8_t *) buf >= slab->buf && (uint8_t *) buf < slab->buf + slab->stats.count*slab->stats.size) {
+      offset = (uint8_t *) buf - slab->buf;
+      idx = offset/slab->stats.size;
+      if (offset%slab->stats.size != 0 || !mesh_pool_in_use(slab, idx)) {  // Not the start of a buffer or released twice
+        os_printf("mesh_pool_release: Invalid buffer!\n");
+        return;
+      }
+      slab->in_use[idx >> 3] &= ~(1 << (idx & 7));
+      slab->free[slab->free_count++] = idx;
+      slab->stats.used--;
+      return;
+    }
+  }
+
+  // The buffer has been allocated from the heap
+  os_free(buf);
+}
+
+// Return the statistics of the buffers of the given size (cf. enum
+// mesh_pool_class_type)
+void ICACHE_FLASH_ATTR mesh_pool_stats_get(uint8_t pool_class, struct mesh_pool_stats_type *stats) {
+  if (pool_class >= MESH_POOL_CLASSES || !stats) {
+    os_printf("mesh_pool_stats_get: Invalid transfer parameters!\n");
+    return;
+  }
+  if (!pool_initialized) {
+    mesh_pool_init();
+  }
+
+  os_memcpy(stats, &pool_slabs[pool_class].stats, sizeof(struct mesh_pool_stats_type));
+}
@@ -0,0 +1,164 @@
+// mesh_task.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: This class defers the processing of received packets and of
+// timer-events to a task of low priority (cf. system_os_task). The receive- and
+// timer-callbacks of the SDK only queue the work and return immediately, so
+// that a burst of packets or a long topology-test doesn't starve the WiFi-stack
+// and trip the watchdog.
+//
+// The queue is bounded (MESH_TASK_QUEUE_LEN); the data of a queued entry (e.g.
+// a received packet) is copied into a buffer of the pool (cf. mesh_pool.c),
+// since the SDK releases its buffer after the callback. The last
+// MESH_TASK_QUEUE_RESERVED entries are reserved for events without data, so
+// that the timer-events aren't lost in a burst of packets. Every run of the
+// task processes the queued entries for at most MESH_TASK_SLICE and yields to
+// the WiFi-stack afterwards; the remaining ones are processed by the next run.
+
+#include "mem.h"
+#include "osapi.h"
+#include "user_interface.h"
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "mesh_task.h"
+#include "user_config.h"
+
+// Length of the task's event-queue; the task is posted only once, as long as
+// it hasn't been run (cf. task_posted)
+#define MESH_TASK_EVENTS 1
+
+// Definition of functions (so there won't be any complications because the
+// compiler resolves the scope top-down):
+static void mesh_task_run(os_event_t *event);
+static void mesh_task_schedule(void);
+
+static os_event_t task_events[MESH_TASK_EVENTS];
+static struct mesh_task_entry_type task_queue[MESH_TASK_QUEUE_LEN]; // Ring-buffer of the queued entries
+static uint8_t task_head = 0;           // Index of the next entry to process
+static uint8_t task_count = 0;          // Number of queued entries
+static bool task_initialized = false;   // The task can only be registered once
+static bool task_posted = false;        // The task has been posted, but hasn't been run yet
+
+static struct mesh_task_stats_type task_stats;
+
+// Post the task, if it isn't already pending
+static void ICACHE_FLASH_ATTR mesh_task_schedule(void) {
+  if (task_posted) {
+    return;
+  }
+
+  task_posted = system_os_post(MESH_TASK_PRIO, 0, 0);
+  if (!task_posted) {
+    os_printf("mesh_task_schedule: Failed to post the task!\n");
+  }
+}
+
+// Task-function, that processes the queued entries in their order for at most
+// MESH_TASK_SLICE (but at least one of them)
+static void ICACHE_FLASH_ATTR mesh_task_run(os_event_t *event) {
+  uint32_t start = system_get_time();
+  struct mesh_task_entry_type entry;
+
+  task_posted = false;
+  task_stats.slices++;
+
+  while (task_count > 0) {
+    // Dequeue the entry before processing it, so that the handler-function can
+    // queue further ones
+    os_memcpy(&entry, &task_queue[task_head], sizeof(struct mesh_task_entry_type));
+    task_head = (task_head+1)%MESH_TASK_QUEUE_LEN;
+    task_count--;
+
+    entry.handler(entry.arg, entry.data, entry.len);
+    mesh_pool_release(entry.data);
+    task_stats.processed++;
+
+    if (system_get_time()-start >= MESH_TASK_SLICE) {
+      break;
+    }
+  }
+
+  // Yield to the WiFi-stack and continue with the next run
+  if (task_count > 0) {
+    mesh_task_schedule();
+  }
+}
+
+// Queue the given handler-function to be executed by the task with the given
+// argument and a copy of the given data (NULL for an event without data);
+// return false, if it couldn't be queued, in which case the caller has to
+// process it directly or drop it
+bool ICACHE_FLASH_ATTR mesh_task_post(mesh_task_handler handler, void *arg, const uint8_t *data, uint16_t len) {
+  struct mesh_task_entry_type *entry = NULL;
+
+  if (!handler) {
+    os_printf("mesh_task_post: Invalid transfer parameter!\n");
+    return false;
+  }
+  if (!task_initialized) {
+    return false;
+  }
+  if ((data && len > ESP_MESH_PKT_LEN_MAX) || task_count >= (data ? MESH_TASK_QUEUE_LEN-MESH_TASK_QUEUE_RESERVED : MESH_TASK_QUEUE_LEN)) {
+    task_stats.dropped++;
+    return false;
+  }
+
+  entry = &task_queue[(task_head+task_count)%MESH_TASK_QUEUE_LEN];
+  entry->data = NULL;
+  if (data && len > 0) {
+    entry->data = (uint8_t *) mesh_pool_acquire(len);
+    if (!entry->data) {
+      task_stats.dropped++;
+      return false;
+    }
+    os_memcpy(entry->data, data, len);
+  }
+  entry->handler = handler;
+  entry->arg = arg;
+  entry->len = len;
+  task_count++;
+  if (task_count > task_stats.pending_max) {
+    task_stats.pending_max = task_count;
+  }
+
+  mesh_task_schedule();
+  return true;
+}
+
+// Return the statistics of the task
+void ICACHE_FLASH_ATTR mesh_task_stats_get(struct mesh_task_stats_type *stats) {
+  if (!stats) {
+    os_printf("mesh_task_stats_get: Invalid transfer parameter!\n");
+    return;
+  }
+  os_memcpy(stats, &task_stats, sizeof(struct mesh_task_stats_type));
+}
+
+// Drop all queued entries and free the occupied resources; the task itself
+// stays registered, since the SDK doesn't allow to remove it
+void ICACHE_FLASH_ATTR mesh_task_release(void) {
+  while (task_count > 0) {
+    mesh_pool_release(task_queue[task_head].data);
+    task_head = (task_head+1)%MESH_TASK_QUEUE_LEN;
+    task_count--;
+  }
+  task_head = 0;
+}
+
+// Register the task, which processes the queued entries
+bool ICACHE_FLASH_ATTR mesh_task_init(void) {
+  if (task_initialized) {
+    return true;
+  }
+
+  if (!system_os_task(mesh_task_run, MESH_TASK_PRIO, task_events, MESH_TASK_EVENTS)) {
+    os_printf("mesh_task_init: Failed to register the task!\n");
+    return false;
+  }
+  os_memset(&task_stats, 0, sizeof(struct mesh_task_stats_type));
+  task_initialized = true;
+  return true;
+}
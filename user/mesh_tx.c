@@ -0,0 +1,260 @@
+// mesh_tx.c
+// Copyright 2017 Lukas Friedrichsen
+// License: Apache License Version 2.0
+//
+// 2026-10-16
+//
+// Description: This class provides a bounded transmit-queue in front of
+// espconn_mesh_sent. A packet is sent right away, as long as nothing is queued;
+// otherwise (or if sending fails temporarily, e.g. since the SDK is out of
+// buffers) a copy of it is queued in a buffer of the pool (cf. mesh_pool.c)
+// and retried with an exponential backoff (MESH_TX_RETRY_INTERVAL up to
+// MESH_TX_RETRY_INTERVAL_MAX). A packet is dropped after MESH_TX_RETRY_MAX
+// failed attempts or on a permanent error, so that a burst degrades gracefully
+// instead of being lost entirely.
+//
+// The piggyback-flags of the mesh-header are used to signal congestion: while
+// further packets are queued behind the one being sent, it carries the
+// congestion-request (cr); once the queue has drained, the congestion is
+// released (cf. espconn_mesh_release_congest). A congestion-request received
+// from the parent-node pauses the transmission until a packet from it carries
+// the congestion-permit (cp) or MESH_TX_PAUSE_TIMEOUT has elapsed.
+
+#include "mem.h"
+#include "osapi.h"
+#include "espconn.h"
+#include "mesh.h"
+#include "mesh_pool.h"
+#include "mesh_tx.h"
+#include "user_config.h"
+
+// Definition of functions (so there won't be any complications because the
+// compiler resolves the scope top-down):
+static void mesh_tx_timerfunc(void *arg);
+static void mesh_tx_flush(void);
+
+static os_timer_t *tx_timer = NULL;
+
+static struct mesh_tx_entry_type tx_queue[MESH_TX_QUEUE_LEN]; // Ring-buffer of the queued packets
+static uint8_t tx_head = 0;             // Index of the next packet to send
+static uint8_t tx_count = 0;            // Number of queued packets
+static uint32_t tx_retry_interval = MESH_TX_RETRY_INTERVAL; // Current backoff-interval (in ms)
+static bool tx_paused = false;          // The parent-node has requested to pause the transmission
+static bool tx_congested = false;       // The node has signaled its own congestion (cf. cr)
+
+static struct mesh_tx_stats_type tx_stats;
+
+// Check, whether the given result of espconn_mesh_sent is a temporary error,
+// after which sending the packet again may succeed
+static bool ICACHE_FLASH_ATTR mesh_tx_transient(sint8 result) {
+  return result == ESPCONN_MEM || result == ESPCONN_TIMEOUT || result == ESPCONN_INPROGRESS || result == ESPCONN_MAXNUM;
+}
+
+// Remove the first packet from the queue and free its copy
+static void ICACHE_FLASH_ATTR mesh_tx_dequeue(void) {
+  mesh_pool_release(tx_queue[tx_head].data);
+  tx_queue[tx_head].data = NULL;
+  tx_head = (tx_head+1)%MESH_TX_QUEUE_LEN;
+  tx_count--;
+}
+
+// (Re-)arm the timer, which either retries the queued packets or ends the pause
+// of the transmission
+static void ICACHE_FLASH_ATTR mesh_tx_timer_arm(uint32_t time) {
+  os_timer_disarm(tx_timer);
+  os_timer_setfn(tx_timer, (os_timer_func_t *) mesh_tx_timerfunc, NULL);
+  os_timer_arm(tx_timer, time, false);
+}
+
+// Send the queued packets in their order, until the queue is empty, the
+// transmission is paused or sending fails temporarily (in which case it's
+// retried after the next backoff-interval)
+static void ICACHE_FLASH_ATTR mesh_tx_flush(void) {
+  sint8 result = ESPCONN_OK;
+  struct mesh_tx_entry_type *entry = NULL;
+
+  while (tx_count > 0 && !tx_paused) {
+    entry = &tx_queue[tx_head];
+
+    // Signal the own congestion, as long as further packets are queued
+    if (tx_count > 1) {
+      ((struct mesh_header_format *) entry->data)->cr = 1;
+      tx_congested = true;
+    }
+
+    result = espconn_mesh_sent(entry->conn, entry->data, entry->len);
+    if (result == ESPCONN_OK) {
+      tx_stats.sent++;
+      tx_retry_interval = MESH_TX_RETRY_INTERVAL;
+      mesh_tx_dequeue();
+    }
+    else if (!mesh_tx_transient(result) || ++entry->attempts >= MESH_TX_RETRY_MAX) {
+      os_printf("mesh_tx_flush: Failed to send the packet (error %d)! Dropping it!\n", result);
+      tx_stats.dropped++;
+      mesh_tx_dequeue();
+    }
+    else {
+      tx_stats.retries++;
+      if (tx_retry_interval*2 <= MESH_TX_RETRY_INTERVAL_MAX) {
+        tx_retry_interval *= 2;
+      }
+      mesh_tx_timer_arm(tx_retry_interval);
+      return;
+    }
+  }
+
+  // Release the congestion, once all queued packets have been sent
+  if (tx_count == 0 && tx_congested) {
+    tx_congested = false;
+    espconn_mesh_release_congest();
+  }
+}
+
+// Timer-function, that retries the queued packets after the backoff-interval
+// or resumes the transmission, if no congestion-permit has been received
+// within MESH_TX_PAUSE_TIMEOUT
+static void ICACHE_FLASH_ATTR mesh_tx_timerfunc(void *arg) {
+  if (tx_paused) {
+    os_printf("mesh_tx_timerfunc: No congestion-permit received! Resuming the transmission!\n");
+    tx_paused = false;
+  }
+  mesh_tx_flush();
+}
+
+// Send the given packet with the given connection or queue a copy of it, if
+// other packets are queued, the transmission is paused or sending fails
+// temporarily; return false, if the packet has been dropped. If the queue
+// hasn't been initialized, the packet is sent directly.
+bool ICACHE_FLASH_ATTR mesh_tx_send(struct espconn *conn, uint8_t *data, uint16_t len) {
+  sint8 result = ESPCONN_OK;
+  struct mesh_tx_entry_type *entry = NULL;
+
+  if (!conn || !data || len < ESP_MESH_HLEN) {
+    os_printf("mesh_tx_send: Invalid transfer parameters!\n");
+    return false;
+  }
+
+  // Send the packet right away, if nothing is queued
+  if (!tx_timer || (tx_count == 0 && !tx_paused)) {
+    result = espconn_mesh_sent(conn, data, len);
+    if (result == ESPCONN_OK) {
+      tx_stats.sent++;
+      return true;
+    }
+    if (!tx_timer || !mesh_tx_transient(result)) {
+      tx_stats.dropped++;
+      return false;
+    }
+  }
+
+  if (tx_count >= MESH_TX_QUEUE_LEN || len > ESP_MESH_PKT_LEN_MAX) {
+    tx_stats.dropped++;
+    return false;
+  }
+  entry = &tx_queue[(tx_head+tx_count)%MESH_TX_QUEUE_LEN];
+  entry->data = (uint8_t *) mesh_pool_acquire(len);
+  if (!entry->data) {
+    tx_stats.dropped++;
+    return false;
+  }
+  os_memcpy(entry->data, data, len);
+  entry->conn = conn;
+  entry->len = len;
+  entry->attempts = result == ESPCONN_OK ? 0 : 1;
+  tx_count++;
+  tx_stats.queued++;
+  if (tx_count > tx_stats.depth_max) {
+    tx_stats.depth_max = tx_count;
+  }
+
+  // The first queued packet is retried after the backoff-interval (unless the
+  // transmission is paused); all further ones are sent after it
+  if (tx_count == 1 && !tx_paused) {
+    mesh_tx_timer_arm(tx_retry_interval);
+  }
+  return true;
+}
+
+// Check, whether the given address is the one of the device's parent-node; the
+// SDK returns the parent's softAP-MAC-address, which differs from its station-
+// MAC-address (used as source-address) only in the locally-administered-bit
+static bool ICACHE_FLASH_ATTR mesh_tx_parent_check(const uint8_t *addr) {
+  uint16_t parent_count = 0;
+  uint8_t *parent_info = NULL;
+  bool result = false;
+
+  if (espconn_mesh_get_node_info(MESH_NODE_PARENT, &parent_info, &parent_count)) {
+    if (parent_info && parent_count >= 1) {
+      result = (parent_info[0] & ~0x02) == (addr[0] & ~0x02) && !os_memcmp(parent_info+1, addr+1, ESP_MESH_ADDR_LEN-1);
+    }
+    espconn_mesh_get_node_info(MESH_NODE_PARENT, NULL, NULL);
+  }
+  return result;
+}
+
+// Evaluate the piggyback-flags of the given (received) packet: a congestion-
+// request of the parent-node pauses the transmission, its congestion-permit
+// resumes it
+void ICACHE_FLASH_ATTR mesh_tx_congest_handle(const struct mesh_header_format *header) {
+  if (!header) {
+    os_printf("mesh_tx_congest_handle: Invalid transfer parameter!\n");
+    return;
+  }
+
+  // Only the flags of packets, which the parent-node itself has sent downwards,
+  // are considered (the flags of packets from other nodes concern their own
+  // links)
+  if (!tx_timer || !(header->cr || header->cp) || header->proto.d || espconn_mesh_is_root() || !mesh_tx_parent_check(header->src_addr)) {
+    return;
+  }
+
+  if (header->cr && !tx_paused) {
+    tx_paused = true;
+    tx_stats.pauses++;
+    mesh_tx_timer_arm(MESH_TX_PAUSE_TIMEOUT);
+  }
+  else if (header->cp && tx_paused) {
+    tx_paused = false;
+    os_timer_disarm(tx_timer);
+    mesh_tx_flush();
+  }
+}
+
+// Return the statistics of the transmit-queue
+void ICACHE_FLASH_ATTR mesh_tx_stats_get(struct mesh_tx_stats_type *stats) {
+  if (!stats) {
+    os_printf("mesh_tx_stats_get: Invalid transfer parameter!\n");
+    return;
+  }
+  tx_stats.depth = tx_count;
+  os_memcpy(stats, &tx_stats, sizeof(struct mesh_tx_stats_type));
+}
+
+// Drop all queued packets and free the occupied resources
+void ICACHE_FLASH_ATTR mesh_tx_release(void) {
+  if (tx_timer) {
+    os_timer_disarm(tx_timer);
+    os_free(tx_timer);
+    tx_timer = NULL;
+  }
+  while (tx_count > 0) {
+    mesh_tx_dequeue();
+  }
+  tx_head = 0;
+  tx_retry_interval = MESH_TX_RETRY_INTERVAL;
+  tx_paused = false;
+  tx_congested = false;
+}
+
+// Initialize the transmit-queue
+bool ICACHE_FLASH_ATTR mesh_tx_init(void) {
+  if (!tx_timer) {
+    tx_timer = (os_timer_t *) os_zalloc(sizeof(os_timer_t));
+  }
+  if (!tx_timer) {
+    os_printf("mesh_tx_init: Failed to initialize the timer of the transmit-queue!\n");
+    return false;
+  }
+  os_memset(&tx_stats, 0, sizeof(struct mesh_tx_stats_type));
+  return true;
+}